@@ -280,25 +280,24 @@ bool BlockIterator::IsTransparent() const
 
 bool BlockIterator::IsSky() const
 {
-    Block* block = GetBlock();
+    Block const* block = GetBlock();
     return block ? block->IsSky() : false;
 }
 
 bool BlockIterator::IsLightDirty() const
 {
-    Block* block = GetBlock();
-    return block ? block->IsLightDirty() : false;
+    return IsValid() && m_chunk->m_lightQueue.Contains(m_blockIndex);
 }
 
 uint8_t BlockIterator::GetOutdoorLight() const
 {
-    Block* block = GetBlock();
+    Block const* block = GetBlock();
     return block ? block->GetOutdoorLight() : 0;
 }
 
 uint8_t BlockIterator::GetIndoorLight() const
 {
-    Block* block = GetBlock();
+    Block const* block = GetBlock();
     return block ? block->GetIndoorLight() : 0;
 }
 
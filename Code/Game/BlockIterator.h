@@ -48,16 +48,24 @@ public:
                m_blockIndex < CHUNK_TOTAL_BLOCKS;
     }
 
-    inline Block* GetBlock() const
+    inline Block const* GetBlock() const
     {
         if (!IsValid())
             return nullptr;
     
-        return &m_chunk->m_blocks[m_blockIndex];
+        return &m_chunk->ReadBlock(m_blockIndex);
+    }
+    // 要写方块时用这个：整段相同的 section 会被展开成数组，所以只在确实要改的时候调
+    inline Block* GetMutableBlock() const
+    {
+        if (!IsValid())
+            return nullptr;
+
+        return &m_chunk->WriteBlock(m_blockIndex);
     }
     inline uint8_t GetBlockType() const
     {
-        Block* block = GetBlock();
+        Block const* block = GetBlock();
         return block ? block->m_typeIndex : BLOCK_TYPE_AIR;
     }
 
@@ -1,5 +1,10 @@
 ﻿#include "Chunk.h"
 
+#include <algorithm>
+#include <cstring>
+
+#include "ChunkLighter.h"
+#include "ChunkMesher.h"
 #include "ChunkUtils.h"
 #include "Game.hpp"
 #include "Player.hpp"
@@ -29,182 +34,454 @@ Chunk::Chunk(World* owner, IntVec2 chunkCoords)
     // GenerateBlocks();
     // m_serializer = new ChunkSerializer(this); 
     // GenerateDebug();
-    m_vertices.reserve(40000);
-    m_indices.reserve(60000);
 
     ReportDirty();
 }
 
 Chunk::~Chunk()
 {
-    if (m_vertexBuffer != nullptr)
+    ReleaseRenderResources();
+    ChunkMeshScratchPool::ReleaseBlockBuffer(m_buildBlocks);
+    m_buildBlocks = nullptr;
+    if (m_serializer)
     {
-        delete m_vertexBuffer;
-        m_vertexBuffer = nullptr;
+        delete m_serializer;
+        m_serializer = nullptr;
+    }
+}
 
-        delete m_vertexBufferDebug;
-        m_vertexBufferDebug = nullptr;
+void Chunk::ResetForReuse(IntVec2 chunkCoords)
+{
+    // 从 ChunkPool 取出时调用：恢复成刚构造的状态，序列化器（含缓冲容量）原地复用
+    m_chunkCoords = chunkCoords;
+    float minX = (float)(chunkCoords.x * CHUNK_SIZE_X);
+    float minY = (float)(chunkCoords.y * CHUNK_SIZE_Y);
+    m_bounds.m_mins = Vec3(minX, minY, 0.f);
+    m_bounds.m_maxs = Vec3(minX + CHUNK_SIZE_X, minY + CHUNK_SIZE_Y, (float)CHUNK_SIZE_Z);
+
+    // SetType 会保留天空/光照脏标记，旧数据必须清掉；section 的数组进池时已经还掉了
+    ReleaseSectionArrays();
+    std::fill(std::begin(m_heightMap), std::end(m_heightMap), (int8_t)-1);
+
+    m_needsSaving = false;
+    m_needsImmediateRebuild = false;
+    m_blockEdits.clear();
+    m_savesFullBlocks = false;
+    m_generatorHash = 0;
+    m_hasRefusedDelta = false;
+    m_state.store(ChunkState::UNINITIALIZED);
+    m_lightQueue.Clear();
+    m_isInLightWorkList = false;
+    m_hasUrgentLight = false;
+    m_lightJobPending = false;
+    m_lightJobSerial = 0;
+    m_hasInteriorLighting = false;
+    m_lightStamp = ChunkLightStamp();
+    m_readyNeighborMask = 0;
+    m_isInMeshReadyQueue = false;
+    m_meshReadyTime = 0.0;
+    m_hasBuiltMesh = false;
+    m_departedBorderMask = 0;
+
+    m_northNeighbor = nullptr;
+    m_southNeighbor = nullptr;
+    m_eastNeighbor = nullptr;
+    m_westNeighbor = nullptr;
+
+    ReleaseRenderResources();
+    MarkMeshDirty();
+    m_meshJobPending = false;
+    m_meshJobSerial = 0;   // 旧坐标上还在飞的 MeshChunkJob 对不上序号，会被丢弃
+
+    ReportDirty();
+}
+
+void Chunk::ReleaseSectionArrays()
+{
+    // 进 ChunkPool 时调用：方块数组还给 ChunkSection 的数组池，池里的 chunk 不占着它们，
+    // 下一个生成/加载的 chunk 在 EndBuild 里直接拿去用
+    ChunkMeshScratchPool::ReleaseBlockBuffer(m_buildBlocks);
+    m_buildBlocks = nullptr;
+    for (ChunkSection& section : m_sections)
+    {
+        section.SetUniform(Block());
     }
-    if (m_indexBuffer != nullptr)
+}
+
+void Chunk::ReleaseRenderResources()
+{
+    // 空 chunk 没有顶点缓冲，但调试线框照样有
+    for (ChunkSectionMesh& sectionMesh : m_sectionMeshes)
     {
-        delete m_indexBuffer;
-        m_indexBuffer = nullptr;
+        delete sectionMesh.m_vertexBuffer;
+        sectionMesh = ChunkSectionMesh();
+    }
+    m_numMeshVertices = 0;
+    delete m_vertexBufferDebug;
+    m_vertexBufferDebug = nullptr;
+    delete m_indexBufferDebug;
+    m_indexBufferDebug = nullptr;
+}
 
-        delete m_indexBufferDebug;
-        m_indexBufferDebug = nullptr;
+Block& Chunk::WriteBlock(int blockIndex)
+{
+    if (m_buildBlocks)
+        return m_buildBlocks[blockIndex];
+    return m_sections[blockIndex >> CHUNK_SECTION_INDEX_BITS].GetMutableBlock(blockIndex & CHUNK_SECTION_INDEX_MASK);
+}
+
+Block const* Chunk::GetSectionBlocks(int section) const
+{
+    if (m_buildBlocks)
+        return m_buildBlocks + section * CHUNK_BLOCKS_PER_SECTION;
+    return m_sections[section].GetBlocks();
+}
+
+Block const& Chunk::GetSectionUniformBlock(int section) const
+{
+    return m_sections[section].GetUniformBlock();
+}
+
+void Chunk::CopyBlocksTo(Block* outBlocks) const
+{
+    if (m_buildBlocks)
+    {
+        memcpy(outBlocks, m_buildBlocks, CHUNK_TOTAL_BLOCKS * sizeof(Block));
+        return;
     }
-    if (m_serializer)
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
     {
-        delete m_serializer;
-        m_serializer = nullptr;
+        m_sections[section].CopyTo(outBlocks + section * CHUNK_BLOCKS_PER_SECTION);
     }
 }
 
+void Chunk::BeginBuild()
+{
+    // 生成器、存档解码和内部光照都按连续下标整块读写，在 worker 上借一块连续缓冲给它们用
+    if (m_buildBlocks)
+        return;
+    Block* buildBlocks = ChunkMeshScratchPool::AcquireBlockBuffer();
+    CopyBlocksTo(buildBlocks);
+    m_buildBlocks = buildBlocks;
+}
+
+void Chunk::EndBuild()
+{
+    // 打包回 section：整段相同的只留一个方块
+    if (!m_buildBlocks)
+        return;
+    Block* buildBlocks = m_buildBlocks;
+    m_buildBlocks = nullptr;
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        m_sections[section].CopyFrom(buildBlocks + section * CHUNK_BLOCKS_PER_SECTION);
+    }
+    ChunkMeshScratchPool::ReleaseBlockBuffer(buildBlocks);
+}
+
+size_t Chunk::GetBlockMemoryBytes() const
+{
+    size_t bytes = 0;
+    for (ChunkSection const& section : m_sections)
+    {
+        bytes += section.GetAllocatedBytes();
+    }
+    return bytes;
+}
+
+void Chunk::CompactDirtySections()
+{
+    // 挖/放展开过的 section 可能又回到了整段相同（比如把一段里唯一的方块挖掉）
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        if (m_dirtySections & (1 << section))
+            m_sections[section].TryCompact();
+    }
+}
+
+int Chunk::GetNumUniformSections() const
+{
+    int numUniform = 0;
+    for (ChunkSection const& section : m_sections)
+    {
+        if (section.IsUniform())
+            numUniform++;
+    }
+    return numUniform;
+}
+
+void Chunk::MarkBlockMeshDirty(int localZ)
+{
+    // 方块的面和光照会画在上下相邻方块上，贴着 section 边界时连相邻 section 一起标
+    int section = localZ >> CHUNK_SECTION_BITS_Z;
+    m_dirtySections |= (uint8_t)(1 << section);
+    int zInSection = localZ & (CHUNK_SECTION_SIZE_Z - 1);
+    if (zInSection == 0 && section > 0)
+        m_dirtySections |= (uint8_t)(1 << (section - 1));
+    if (zInSection == CHUNK_SECTION_SIZE_Z - 1 && section < CHUNK_NUM_SECTIONS - 1)
+        m_dirtySections |= (uint8_t)(1 << (section + 1));
+}
+
 void Chunk::InitializeLighting()
 {
-     // 标记与相邻 Chunk 接触的边界非不透明方块为脏 
-    if (m_eastNeighbor && m_eastNeighbor->GetState() == ChunkState::ACTIVE)
+    // 内部的天空光/方块光在 worker 上生成或加载时已经算好，这里只对齐与已激活邻居相接的四个边界面
+    if (!m_hasInteriorLighting)
     {
-        for (int y = 0; y < CHUNK_SIZE_Y; y++)
+        BeginBuild();
+        ComputeInteriorLighting();
+        EndBuild();
+    }
+
+    // 存档光照可信时，保存那一刻就在场、朝向本 chunk 的那一面也没变过的邻居不用再对齐
+    LightingStats& stats = m_world->m_lightingStats;
+    if (m_lightStamp.m_isValid)
+    {
+        stats.m_numTrustedLightLoads++;
+    }
+
+    Direction const horizontalDirs[] = { DIRECTION_EAST, DIRECTION_WEST, DIRECTION_NORTH, DIRECTION_SOUTH };
+    for (Direction dir : horizontalDirs)
+    {
+        Chunk* neighbor = GetNeighbor(dir);
+        if (neighbor && neighbor->GetState() == ChunkState::ACTIVE)
         {
-            for (int z = 0; z < CHUNK_SIZE_Z; z++)
+            if (m_lightStamp.m_isValid && (m_lightStamp.m_neighborMask & (1 << dir)) &&
+                m_lightStamp.m_borderHashes[dir] == neighbor->HashBorderFace(GetOppositeDirection(dir)))
             {
-                int idx = LocalCoordsToIndex(CHUNK_MAX_X, y, z);
-                if (!m_blocks[idx].IsOpaque())
-                {
-                    BlockIterator iter(this, idx);
-                    m_world->MarkLightingDirty(iter);
-                }
+                stats.m_numBorderFacesSkipped++;
+                continue;
             }
+            MarkBoundaryLightingDirty(dir);
+            neighbor->MarkBoundaryLightingDirty(GetOppositeDirection(dir));
+            stats.m_numBorderFacesRelit++;
         }
     }
-    
-    if (m_westNeighbor && m_westNeighbor->GetState() == ChunkState::ACTIVE)
+
+    // 凭据只在激活这一次有用，之后以内存里的光照为准
+    m_lightStamp = ChunkLightStamp();
+}
+
+void Chunk::CaptureLightStamp()
+{
+    // 保存前在主线程调用（邻居还连着）：本 chunk 光照已收敛才给存档打上可信标记
+    m_lightStamp = ChunkLightStamp();
+    if (!m_lightQueue.IsEmpty() || m_lightJobPending)
+        return;
+
+    m_lightStamp.m_isValid = true;
+    Direction const horizontalDirs[] = { DIRECTION_EAST, DIRECTION_WEST, DIRECTION_NORTH, DIRECTION_SOUTH };
+    for (Direction dir : horizontalDirs)
     {
-        for (int y = 0; y < CHUNK_SIZE_Y; y++)
+        Chunk* neighbor = GetNeighbor(dir);
+        if (neighbor && neighbor->GetState() == ChunkState::ACTIVE)
         {
-            for (int z = 0; z < CHUNK_SIZE_Z; z++)
-            {
-                int idx = LocalCoordsToIndex(0, y, z);
-                if (!m_blocks[idx].IsOpaque())
-                {
-                    BlockIterator iter(this, idx);
-                    m_world->MarkLightingDirty(iter);
-                }
-            }
+            m_lightStamp.m_neighborMask |= (uint8_t)(1 << dir);
+            m_lightStamp.m_borderHashes[dir] = neighbor->HashBorderFace(GetOppositeDirection(dir));
         }
     }
-    
-    if (m_northNeighbor && m_northNeighbor->GetState() == ChunkState::ACTIVE)
+}
+
+uint32_t Chunk::HashBorderFace(Direction dir) const
+{
+    // 朝 dir 一侧边界面上方块类型和光照的 FNV-1a
+    int fixedX = -1;
+    int fixedY = -1;
+    switch (dir)
     {
-        for (int x = 0; x < CHUNK_SIZE_X; x++)
+    case DIRECTION_EAST:  fixedX = CHUNK_MAX_X; break;
+    case DIRECTION_WEST:  fixedX = 0; break;
+    case DIRECTION_NORTH: fixedY = CHUNK_MAX_Y; break;
+    case DIRECTION_SOUTH: fixedY = 0; break;
+    default: return 0;
+    }
+
+    uint32_t hash = 2166136261u;
+    for (int z = 0; z < CHUNK_SIZE_Z; z++)
+    {
+        for (int along = 0; along < CHUNK_SIZE_X; along++)
         {
-            for (int z = 0; z < CHUNK_SIZE_Z; z++)
+            int idx = fixedX >= 0 ? LocalCoordsToIndex(fixedX, along, z) : LocalCoordsToIndex(along, fixedY, z);
+            Block const& block = ReadBlock(idx);
+            hash = (hash ^ block.m_typeIndex) * 16777619u;
+            hash = (hash ^ block.m_lightData) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+uint32_t Chunk::HashBorderOpacity(Direction dir, int section) const
+{
+    // 朝 dir 一侧边界面在一个 section 里的不透明掩码；透明格再带上光照（邻居面的亮度取自它）。
+    // 对面 chunk 贴边的面露不露出来、多亮，只取决于这些
+    int fixedX = -1;
+    int fixedY = -1;
+    switch (dir)
+    {
+    case DIRECTION_EAST:  fixedX = CHUNK_MAX_X; break;
+    case DIRECTION_WEST:  fixedX = 0; break;
+    case DIRECTION_NORTH: fixedY = CHUNK_MAX_Y; break;
+    case DIRECTION_SOUTH: fixedY = 0; break;
+    default: return 0;
+    }
+
+    uint32_t hash = 2166136261u;
+    int zBegin = section * CHUNK_SECTION_SIZE_Z;
+    for (int z = zBegin; z < zBegin + CHUNK_SECTION_SIZE_Z; z++)
+    {
+        for (int along = 0; along < CHUNK_SIZE_X; along++)
+        {
+            int idx = fixedX >= 0 ? LocalCoordsToIndex(fixedX, along, z) : LocalCoordsToIndex(along, fixedY, z);
+            Block const& block = ReadBlock(idx);
+            bool isOpaque = block.IsOpaque();
+            hash = (hash ^ (isOpaque ? 1u : 0u)) * 16777619u;
+            if (!isOpaque)
+                hash = (hash ^ block.m_lightData) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+void Chunk::MarkBoundaryLightingDirty(Direction dir)
+{
+    // 把朝 dir 一侧的整个边界面（非不透明方块）标脏
+    int fixedX = -1;
+    int fixedY = -1;
+    switch (dir)
+    {
+    case DIRECTION_EAST:  fixedX = CHUNK_MAX_X; break;
+    case DIRECTION_WEST:  fixedX = 0; break;
+    case DIRECTION_NORTH: fixedY = CHUNK_MAX_Y; break;
+    case DIRECTION_SOUTH: fixedY = 0; break;
+    default: return;
+    }
+
+    for (int z = 0; z < CHUNK_SIZE_Z; z++)
+    {
+        // 整段都是同一种不透明方块（深处的石头）直接跳过
+        int section = z >> CHUNK_SECTION_BITS_Z;
+        if (!m_buildBlocks && m_sections[section].IsUniform() && m_sections[section].GetUniformBlock().IsOpaque())
+        {
+            z += CHUNK_SECTION_SIZE_Z - 1;
+            continue;
+        }
+        for (int along = 0; along < CHUNK_SIZE_X; along++)
+        {
+            int idx = fixedX >= 0 ? LocalCoordsToIndex(fixedX, along, z) : LocalCoordsToIndex(along, fixedY, z);
+            if (!ReadBlock(idx).IsOpaque())
             {
-                int idx = LocalCoordsToIndex(x, CHUNK_MAX_Y, z);
-                if (!m_blocks[idx].IsOpaque())
-                {
-                    BlockIterator iter(this, idx);
-                    m_world->MarkLightingDirty(iter);
-                }
+                BlockIterator iter(this, idx);
+                m_world->MarkLightingDirty(iter);
             }
         }
     }
-    
-    if (m_southNeighbor && m_southNeighbor->GetState() == ChunkState::ACTIVE)
+}
+
+void Chunk::MarkSkyColumns()
+{
+    // 高度图以上都是天空，室外光 15
+    for (int y = 0; y < CHUNK_SIZE_Y; y++)
     {
         for (int x = 0; x < CHUNK_SIZE_X; x++)
         {
-            for (int z = 0; z < CHUNK_SIZE_Z; z++)
+            for (int z = CHUNK_MAX_Z; z > GetColumnHeight(x, y); z--)
             {
-                int idx = LocalCoordsToIndex(x, 0, z);
-                if (!m_blocks[idx].IsOpaque())
-                {
-                    BlockIterator iter(this, idx);
-                    m_world->MarkLightingDirty(iter);
-                }
+                Block& block = m_buildBlocks[LocalCoordsToIndex(x, y, z)];
+                block.SetIsSky(true);
+                block.SetOutdoorLight(15);
             }
         }
     }
-    
-    // ===== 步骤2 & 3：标记天空方块并设置室外光 =====
-    for (int y = 0; y < CHUNK_SIZE_Y; y++)
+}
+
+void Chunk::ComputeInteriorLighting()
+{
+    // 在 GenerateChunkJob / LoadChunkJob 的 worker 上调用（chunk 尚未连接邻居）：
+    // 标记天空列、天空方块室外光 15，再只在本 chunk 内部传播天空光和发光方块的光
+    ChunkLightQueue queue;
+    MarkSkyColumns();
+
+    for (int idx = 0; idx < CHUNK_TOTAL_BLOCKS; idx++)
     {
-        for (int x = 0; x < CHUNK_SIZE_X; x++)
+        Block const& block = m_buildBlocks[idx];
+        const BlockDefinition& def = BlockDefinition::GetBlockDef(block.m_typeIndex);
+        if (def.m_indoorLightInfluence > 0 || def.m_outdoorLightInfluence > 0)
         {
-            // 从上往下找第一个不透明方块
-            for (int z = CHUNK_SIZE_Z - 1; z >= 0; z--)
+            queue.Push(idx);
+        }
+        if (!block.IsSky())
+            continue;
+
+        // 天空方块旁边的非天空、非不透明方块从这里开始往里传播
+        IntVec3 local = IndexToLocalCoords(idx);
+        int const neighborOffsets[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+        for (auto const& offset : neighborOffsets)
+        {
+            int nx = local.x + offset[0];
+            int ny = local.y + offset[1];
+            if (nx < 0 || nx > CHUNK_MAX_X || ny < 0 || ny > CHUNK_MAX_Y)
+                continue;
+            int neighborIdx = LocalCoordsToIndex(nx, ny, local.z);
+            Block const& neighbor = m_buildBlocks[neighborIdx];
+            if (!neighbor.IsSky() && !neighbor.IsOpaque())
             {
-                int idx = LocalCoordsToIndex(x, y, z);
-                Block& block = m_blocks[idx];
-                
-                if (block.IsOpaque())
-                {
-                    // 遇到不透明方块，停止
-                    break;
-                }
-                else
-                {
-                    block.SetIsSky(true);
-                }
+                queue.Push(neighborIdx);
             }
         }
     }
-    
-    // ===== 步骤4：为天空方块设置室外光，并标记其水平邻居为脏 =====
-    for (int z = 0; z < CHUNK_SIZE_Z; z++)
+
+    if (!queue.IsEmpty())
     {
-        for (int y = 0; y < CHUNK_SIZE_Y; y++)
+        // 没连邻居时快照边界全部视为缺失，传播只在 chunk 内部进行
+        ChunkMeshSnapshot* snapshot = ChunkMeshScratchPool::AcquireSnapshot();
+        snapshot->CopyFrom(this);
+        ChunkLightResult result;
+        ChunkLighter::PropagateLight(*snapshot, queue, result);
+        ChunkMeshScratchPool::ReleaseSnapshot(snapshot);
+        for (auto const& [blockIndex, lightData] : result.m_changedLight)
         {
-            for (int x = 0; x < CHUNK_SIZE_X; x++)
+            m_buildBlocks[blockIndex].m_lightData = lightData;
+        }
+    }
+    m_hasInteriorLighting = true;
+}
+
+void Chunk::RebuildHeightMap()
+{
+    for (int y = 0; y < CHUNK_SIZE_Y; y++)
+    {
+        for (int x = 0; x < CHUNK_SIZE_X; x++)
+        {
+            int z = CHUNK_MAX_Z;
+            while (z >= 0 && !m_buildBlocks[LocalCoordsToIndex(x, y, z)].IsOpaque())
             {
-                int idx = LocalCoordsToIndex(x, y, z);
-                Block& block = m_blocks[idx];
-                
-                if (block.IsSky())
-                {
-                    // 设置室外光 = 15
-                    block.SetOutdoorLight(15);
-                    
-                    // 标记四个水平方向的非天空非不透明邻居为脏
-                    Direction horizontalDirs[] = {
-                        DIRECTION_EAST, DIRECTION_WEST, 
-                        DIRECTION_NORTH, DIRECTION_SOUTH
-                    };
-                    
-                    for (Direction dir : horizontalDirs)
-                    {
-                        BlockIterator iter(this, idx);
-                        BlockIterator neighbor = iter.GetNeighborCrossBoundary(dir);
-                        
-                        if (neighbor.IsValid())
-                        {
-                            Block* neighborBlock = neighbor.GetBlock();
-                            if (neighborBlock && 
-                                !neighborBlock->IsSky() && 
-                                !neighborBlock->IsOpaque())
-                            {
-                                m_world->MarkLightingDirty(neighbor);
-                            }
-                        }
-                    }
-                }
+                z--;
             }
+            m_heightMap[x | (y << CHUNK_BITS_X)] = (int8_t)z;
         }
     }
-    
-    // 步骤5：标记所有发光方块为脏
-    for (int idx = 0; idx < CHUNK_TOTAL_BLOCKS; idx++)
+}
+
+int Chunk::UpdateColumnHeight(int localX, int localY, int localZ)
+{
+    // (localX, localY, localZ) 的方块刚被改过：变不透明只会抬高，顶部方块被挖掉才往下找新的顶，
+    // 代价是高度差。返回改之前的高度
+    int8_t& height = m_heightMap[localX | (localY << CHUNK_BITS_X)];
+    int previousHeight = height;
+    if (ReadBlock(LocalCoordsToIndex(localX, localY, localZ)).IsOpaque())
     {
-        Block& block = m_blocks[idx];
-        const BlockDefinition& def = BlockDefinition::GetBlockDef(block.m_typeIndex);
-        
-        if (def.m_indoorLightInfluence > 0 || def.m_outdoorLightInfluence > 0)
+        if (localZ > height)
+            height = (int8_t)localZ;
+    }
+    else if (localZ == height)
+    {
+        int z = localZ - 1;
+        while (z >= 0 && !ReadBlock(LocalCoordsToIndex(localX, localY, z)).IsOpaque())
         {
-            BlockIterator iter(this, idx);
-            m_world->MarkLightingDirty(iter);
+            z--;
         }
+        height = (int8_t)z;
     }
+    return previousHeight;
 }
 
 int Chunk::GetBlockLocalIndexFromLocalCoords(int x, int y, int z) const
@@ -234,7 +511,7 @@ IntVec3 Chunk::GetLocalCoordsFromIndex(int index) const
 
 Block Chunk::GetBlock(int localX, int localY, int localZ) const
 {
-    return m_blocks[GetBlockLocalIndexFromLocalCoords(localX, localY, localZ)];
+    return ReadBlock(GetBlockLocalIndexFromLocalCoords(localX, localY, localZ));
 }
 
 Vec3 Chunk::GetBlockWorldPosition(int blockIndex) const
@@ -258,7 +535,7 @@ void Chunk::Update(float deltaSeconds)
 
 void Chunk::Render() const
 {
-    if (m_vertexBuffer)
+    if (m_numMeshVertices > 0)
     {
 		g_theRenderer->BindShader(m_world->m_worldShader);
 		g_theRenderer->SetBlendMode(BlendMode::ALPHA);
@@ -266,13 +543,18 @@ void Chunk::Render() const
 		g_theRenderer->SetDepthMode(DepthMode::READ_WRITE_LESS_EQUAL);
 		g_theRenderer->SetSamplerMode(SamplerMode::BILINEAR_WRAP);
 
-		// Mat44 mat;
-		// mat.SetTranslation2D(Vec2((float)(m_chunkCoords.x * CHUNK_SIZE_X),
-		// 	(float)(m_chunkCoords.y * CHUNK_SIZE_Y)));
-		// g_theRenderer->SetModelConstants(mat);
-        g_theRenderer->SetModelConstants();
+		// 顶点是 chunk 内局部坐标
+		Mat44 mat;
+		mat.SetTranslation3D(Vec3(m_bounds.m_mins.x, m_bounds.m_mins.y, 0.f));
+		g_theRenderer->SetModelConstants(mat);
 		g_theRenderer->BindTexture(&m_world->m_owner->m_spriteSheet->GetTexture());
-		g_theRenderer->DrawIndexBuffer(m_vertexBuffer, m_indexBuffer, (unsigned int)m_indices.size());
+		for (ChunkSectionMesh const& sectionMesh : m_sectionMeshes)
+		{
+		    if (sectionMesh.m_numVertices == 0)
+		        continue;
+		    unsigned int numIndices = sectionMesh.m_numVertices / CHUNK_VERTS_PER_QUAD * CHUNK_INDICES_PER_QUAD;
+		    g_theRenderer->DrawIndexBuffer(sectionMesh.m_vertexBuffer, m_world->GetQuadIndexBuffer(), numIndices);
+		}
 
 		if (m_world->IsDebugging())
 		{
@@ -367,7 +649,7 @@ void Chunk::MarkNeighborChunkDirty(Direction dir)
     Chunk* neighbor = GetNeighbor(dir);
     if (neighbor)
     {
-        neighbor->m_isDirty = true;
+        neighbor->MarkMeshDirty();
         neighbor->m_needsImmediateRebuild = true;
     }
 }
@@ -413,32 +695,43 @@ void Chunk::DigBlock(const IntVec3& localCoords)
     if (!iter.IsValid())
         return;
 
-    Block* block = iter.GetBlock();
-    if (!CanDigBlock(block->m_typeIndex))
+    if (!CanDigBlock(iter.GetBlockType()))
         return;
     
+    Block* block = iter.GetMutableBlock();
+    uint8_t previousType = block->m_typeIndex;
     block->SetType(BLOCK_TYPE_AIR);
+    RecordBlockEdit(iter.GetIndex(), previousType);
     //block->SetIsOpaque(false);
     //block->SetIsSolid(false);
     //block->SetIsVisible(false);
     
-    m_world->MarkLightingDirty(iter);
+    // 两阶段模式下收集改动的方块，最后一次性交给 RelightAfterEdit
+    bool const useTwoPhaseLight = g_theGame->g_useLightRemovalBfs;
+    std::vector<BlockIterator> editedBlocks;
+    editedBlocks.push_back(iter);
+    if (!useTwoPhaseLight)
+    {
+        m_world->MarkLightingDirty(iter);
+        m_world->PrioritizeLighting(this);
+    }
     
-    BlockIterator above = iter.GetNeighborCrossBoundary(DIRECTION_UP);
-    if (above.IsValid() && above.IsSky())
+    // 挖掉的是列顶：从这里到新的列顶之间都变成天空
+    int previousHeight = UpdateColumnHeight(localCoords.x, localCoords.y, localCoords.z);
+    for (int z = previousHeight; z > GetColumnHeight(localCoords.x, localCoords.y); z--)
     {
-        BlockIterator current = iter;
-        while (current.IsValid())
+        BlockIterator current(this, IntVec3(localCoords.x, localCoords.y, z));
+        Block* currentBlock = current.GetMutableBlock();
+        currentBlock->SetIsSky(true);
+        MarkBlockMeshDirty(z);
+        if (useTwoPhaseLight)
+        {
+            editedBlocks.push_back(current);
+        }
+        else
         {
-            Block* currentBlock = current.GetBlock();
-            if (!currentBlock || currentBlock->IsOpaque())
-                break;
-            
-            currentBlock->SetIsSky(true);
             currentBlock->SetOutdoorLight(15);
             m_world->MarkLightingDirty(current);
-            
-            current = current.GetNeighborCrossBoundary(DIRECTION_DOWN);
         }
     }
     
@@ -447,12 +740,13 @@ void Chunk::DigBlock(const IntVec3& localCoords)
         BlockIterator neighbor = iter.GetNeighborCrossBoundary((Direction)dir);
         if (neighbor.IsValid())
         {
-            m_world->MarkLightingDirtyIfNotOpaque(neighbor);
+            if (!useTwoPhaseLight)
+                m_world->MarkLightingDirtyIfNotOpaque(neighbor);
             
             // 如果邻居在不同 Chunk，标记那个 Chunk 为脏
             if (neighbor.GetChunk() != this)
             {
-                neighbor.GetChunk()->m_isDirty = true;
+                neighbor.GetChunk()->MarkBlockMeshDirty(localCoords.z);
                 m_world->m_hasDirtyChunk = true;
             }
         }
@@ -471,7 +765,15 @@ void Chunk::DigBlock(const IntVec3& localCoords)
         }
     }
     
-    GenerateMesh();
+    if (useTwoPhaseLight)
+    {
+        m_world->RelightAfterEdit(editedBlocks);
+    }
+    
+    // 网格交给 MeshChunkJob，下一帧优先提交
+    MarkBlockMeshDirty(localCoords.z);
+    m_needsImmediateRebuild = true;
+    ReportDirty();
     m_needsSaving = true;
 }
 
@@ -481,11 +783,10 @@ void Chunk::PlaceBlock(const IntVec3& localCoords, uint8_t blockType)
     if (!iter.IsValid())
         return;
 
-    Block* block = iter.GetBlock();
-    
-    if (block->m_typeIndex != BLOCK_TYPE_AIR && 
-        block->m_typeIndex != BLOCK_TYPE_WATER &&
-        block->m_typeIndex != BLOCK_TYPE_LAVA)
+    uint8_t targetType = iter.GetBlockType();
+    if (targetType != BLOCK_TYPE_AIR && 
+        targetType != BLOCK_TYPE_WATER &&
+        targetType != BLOCK_TYPE_LAVA)
         return;
     
     if (!HasSupport(localCoords, blockType))
@@ -493,48 +794,54 @@ void Chunk::PlaceBlock(const IntVec3& localCoords, uint8_t blockType)
         return; 
     }
 
-    bool wasSky = block->IsSky();
-    
     //const BlockDefinition& blockDef = BlockDefinition::GetBlockDef(blockType);
     
+    Block* block = iter.GetMutableBlock();
+    uint8_t previousType = block->m_typeIndex;
     block->SetType(blockType);
+    RecordBlockEdit(iter.GetIndex(), previousType);
     //block->SetIsOpaque(blockDef.m_isOpaque);
     //block->SetIsSolid(blockDef.m_isSolid);
     //block->SetIsVisible(blockDef.m_isVisible);
     
-    // 1. 标记该方块光照为脏
-    m_world->MarkLightingDirty(iter);
+    // 1. 标记该方块光照为脏（两阶段模式下先收集，最后交给 RelightAfterEdit）
+    bool const useTwoPhaseLight = g_theGame->g_useLightRemovalBfs;
+    std::vector<BlockIterator> editedBlocks;
+    editedBlocks.push_back(iter);
+    if (!useTwoPhaseLight)
+    {
+        m_world->MarkLightingDirty(iter);
+        m_world->PrioritizeLighting(this);
+    }
     
-    // 2. 如果被替换的方块是天空 且 新方块不透明，向下清除天空标记
-    if (wasSky && block->IsOpaque())
+    // 2. 新方块不透明且高过列顶：从它到旧列顶之间清除天空标记
+    int previousHeight = UpdateColumnHeight(localCoords.x, localCoords.y, localCoords.z);
+    if (GetColumnHeight(localCoords.x, localCoords.y) != previousHeight)
     {
         // 清除当前方块的天空标记
         block->SetIsSky(false);
-        block->SetOutdoorLight(0);
+        if (!useTwoPhaseLight)
+            block->SetOutdoorLight(0);
         
-        // 向下遍历，清除所有天空标记
-        BlockIterator current = iter.GetNeighborCrossBoundary(DIRECTION_DOWN);
-        while (current.IsValid())
+        for (int z = localCoords.z - 1; z > previousHeight; z--)
         {
-            Block* currentBlock = current.GetBlock();
-            if (!currentBlock)
-                break;
-            
-            if (!currentBlock->IsSky())
-            {
-                // 已经不是天空了，停止
-                break;
-            }
+            BlockIterator current(this, IntVec3(localCoords.x, localCoords.y, z));
+            Block* currentBlock = current.GetMutableBlock();
             
             // 清除天空标记
             currentBlock->SetIsSky(false);
-            currentBlock->SetOutdoorLight(0);
-            
-            // 标记光照为脏
-            m_world->MarkLightingDirty(current);
-            
-            // 向下移动
-            current = current.GetNeighborCrossBoundary(DIRECTION_DOWN);
+            MarkBlockMeshDirty(z);
+            if (useTwoPhaseLight)
+            {
+                editedBlocks.push_back(current);
+            }
+            else
+            {
+                currentBlock->SetOutdoorLight(0);
+                
+                // 标记光照为脏
+                m_world->MarkLightingDirty(current);
+            }
         }
     }
     
@@ -543,11 +850,12 @@ void Chunk::PlaceBlock(const IntVec3& localCoords, uint8_t blockType)
         BlockIterator neighbor = iter.GetNeighborCrossBoundary((Direction)dir);
         if (neighbor.IsValid())
         {
-            m_world->MarkLightingDirtyIfNotOpaque(neighbor);
+            if (!useTwoPhaseLight)
+                m_world->MarkLightingDirtyIfNotOpaque(neighbor);
             
             if (neighbor.GetChunk() != this)
             {
-                neighbor.GetChunk()->m_isDirty = true;
+                neighbor.GetChunk()->MarkBlockMeshDirty(localCoords.z);
                 m_world->m_hasDirtyChunk = true;
             }
         }
@@ -566,7 +874,15 @@ void Chunk::PlaceBlock(const IntVec3& localCoords, uint8_t blockType)
         }
     }
     
-    GenerateMesh();
+    if (useTwoPhaseLight)
+    {
+        m_world->RelightAfterEdit(editedBlocks);
+    }
+    
+    // 网格交给 MeshChunkJob，下一帧优先提交
+    MarkBlockMeshDirty(localCoords.z);
+    m_needsImmediateRebuild = true;
+    ReportDirty();
     m_needsSaving = true;
 }
 
@@ -648,8 +964,8 @@ bool Chunk::HasSupport(const IntVec3& localCoords, uint8_t blockType)
         if (localCoords.z > 0)
         {
             int belowIdx = LocalCoordsToIndex(localCoords);
-            if (m_blocks[belowIdx].m_typeIndex == BLOCK_TYPE_AIR ||
-                m_blocks[belowIdx].m_typeIndex == BLOCK_TYPE_WATER)
+            if (ReadBlock(belowIdx).m_typeIndex == BLOCK_TYPE_AIR ||
+                ReadBlock(belowIdx).m_typeIndex == BLOCK_TYPE_WATER)
             {
                 return false;
             }
@@ -674,7 +990,7 @@ bool Chunk::HasSupport(const IntVec3& localCoords, uint8_t blockType)
                         z >= 0 && z < CHUNK_SIZE_Z)
                     {
                         int idx = LocalCoordsToIndex(x, y, z);
-                        if (IsLog(m_blocks[idx].m_typeIndex))
+                        if (IsLog(ReadBlock(idx).m_typeIndex))
                         {
                             return true;
                         }
@@ -691,27 +1007,61 @@ bool Chunk::HasSupport(const IntVec3& localCoords, uint8_t blockType)
 		if (belowZ < 0)
 			return false;
 
-		uint8_t belowType = m_blocks[LocalCoordsToIndex(localCoords.x, localCoords.y, belowZ)].m_typeIndex;
+		uint8_t belowType = ReadBlock(LocalCoordsToIndex(localCoords.x, localCoords.y, belowZ)).m_typeIndex;
 		return IsSolid(belowType);
     }
     return true; 
 }
 
-void Chunk::Save()
+bool Chunk::Save()
 {
     //if (!m_needsSaving)
     //    return;
     
     if (!m_serializer)
         m_serializer = new ChunkSerializer(this);
-
-    // for (int i = 0; i < CHUNK_TOTAL_BLOCKS; i++)
-    // {
-    //     m_serializer->m_blockData[i] = m_blocks[i].m_typeIndex;
-    // }
-    memcpy(m_serializer->m_blockData, m_blocks, CHUNK_TOTAL_BLOCKS * sizeof(Block));
-    g_theSaveSystem->Save(MakeChunkFilename(m_chunkCoords), m_serializer, SaveFormat::BINARY);
+    std::vector<uint8_t>& buffer = m_serializer->m_ioBuffer;
+    buffer.clear();
+    if (g_theGame->g_saveOnlyPlayerEdits && !m_savesFullBlocks)
+    {
+        // 没改过也没存过的 chunk 不落盘，下次直接重新生成
+        if (m_blockEdits.empty() && !m_world->HasSavedChunk(m_chunkCoords))
+        {
+            m_needsSaving = false;
+            return true;
+        }
+        // 被拒绝的旧 delta 没能另存一份时，region 里的就是唯一的原件，新改动宁可丢也不覆盖它
+        if (m_hasRefusedDelta)
+        {
+            if (!m_blockEdits.empty())
+            {
+                DebuggerPrintf("Chunk (%d, %d): %d edits not saved, an unreadable older save is kept in its place\n",
+                    m_chunkCoords.x, m_chunkCoords.y, (int)m_blockEdits.size());
+            }
+            m_needsSaving = false;
+            return true;
+        }
+        ChunkDeltaHeader deltaHeader;
+        deltaHeader.m_generatorVersion = WORLD_GEN_VERSION;
+        deltaHeader.m_generatorHash = m_generatorHash;
+        ChunkSerializer::WriteDelta(m_blockEdits, deltaHeader, buffer);
+    }
+    else
+    {
+        // 直接从 section 编码，不再先拷一份到 serializer
+        //g_theSaveSystem->Save(MakeChunkFilename(m_chunkCoords), m_serializer, SaveFormat::BINARY);
+        m_serializer->m_saveLight = g_theGame->g_saveChunkLighting;
+        m_serializer->SaveToBinary(buffer);
+    }
+    if (!m_world->m_regionStorage->WriteChunk(m_chunkCoords, buffer))
+    {
+        // 改动还在内存里，由调用方决定重试或保留这个 chunk
+        DebuggerPrintf("Failed to save chunk (%d, %d)\n", m_chunkCoords.x, m_chunkCoords.y);
+        return false;
+    }
+    m_world->MarkChunkSaved(m_chunkCoords);
     m_needsSaving = false;
+    return true;
 }
 
 bool Chunk::Load()
@@ -719,20 +1069,30 @@ bool Chunk::Load()
     if (!m_serializer)
         m_serializer = new ChunkSerializer(this);
     
-    const std::string fn = MakeChunkFilename(m_chunkCoords);
-    if (!g_theSaveSystem->FileExists(fn))
-        return false;
-    
-    if (!g_theSaveSystem->FileExists(fn))
-        return false;
+    bool loadedFromLegacyFile = false;
+    std::vector<uint8_t>& buffer = m_serializer->m_ioBuffer;
+    if (m_world->m_regionStorage->ReadChunk(m_chunkCoords, buffer))
+    {
+        if (ChunkSerializer::PeekVersion(buffer) == CHUNK_FILE_VERSION_DELTA)
+            return LoadFromDelta(buffer);
 
-    // 调用 ISerializable::Load → 解压到 serializer 的缓冲
-    if (!g_theSaveSystem->Load(fn, m_serializer, SaveFormat::BINARY))
-        return false;
+        size_t offset = 0;
+        if (!m_serializer->LoadFromBinary(buffer, offset))
+            return false;
+    }
+    else
+    {
+        // 旧版单文件存档：照旧读取，下次保存时写进 region
+        const std::string fn = MakeChunkFilename(m_chunkCoords);
+        if (!g_theSaveSystem->FileExists(fn))
+            return false;
+
+        // 调用 ISerializable::Load → LoadFromBinary 直接解压到构建缓冲
+        if (!g_theSaveSystem->Load(fn, m_serializer, SaveFormat::BINARY))
+            return false;
+        loadedFromLegacyFile = true;
+    }
 
-    //解压结果回写到 Chunk 的方块数组
-    size_t totalBytes = CHUNK_TOTAL_BLOCKS * sizeof(Block);
-    memcpy(m_blocks, m_serializer->m_blockData, totalBytes);
     // for (int i = 0; i < CHUNK_TOTAL_BLOCKS; ++i)
     // {
     //     m_blocks[i].m_typeIndex = m_serializer->m_blockData[i];
@@ -742,11 +1102,97 @@ bool Chunk::Load()
     //     m_blocks[i].SetIsVisible(blockDef.m_isVisible);
     // }
 
-    m_isDirty = true;
+    RebuildHeightMap();
+    if (m_lightStamp.m_isValid)
+    {
+        // 天空标记不存盘，按高度图补回；光照直接用存档里的，不再重算内部
+        MarkSkyColumns();
+        m_hasInteriorLighting = true;
+    }
+    else
+    {
+        // 不可信的旧光照只会让增量传播卡在偏高的值上，清零后照常重算
+        for (int i = 0; i < CHUNK_TOTAL_BLOCKS; ++i)
+        {
+            Block& block = m_buildBlocks[i];
+            block.m_lightData = 0;
+        }
+    }
+    MarkMeshDirty();
+    m_needsSaving = loadedFromLegacyFile;
+    m_savesFullBlocks = true;
+    return true;
+}
+
+bool Chunk::LoadFromDelta(const std::vector<uint8_t>& buffer)
+{
+    std::vector<std::pair<uint16_t, uint8_t>> edits;
+    ChunkDeltaHeader deltaHeader;
+    size_t offset = 0;
+    if (!ChunkSerializer::ReadDelta(buffer, offset, deltaHeader, edits))
+        return false;
+
+    // 生成器是确定性的：先还原生成结果，再叠加玩家改动
+    GenerateBlocks();
+    m_blockEdits.clear();
+
+    // 底图不是保存时那一份，改动的下标套上去会落在别的地形上：拒绝这份 delta，按新生成的地形使用。
+    // 原件先搬到 SetAside/ 保留；搬不走就让这个 chunk 不再写盘
+    if (deltaHeader.m_generatorVersion != WORLD_GEN_VERSION || deltaHeader.m_generatorHash != m_generatorHash)
+    {
+        bool isSetAside = m_world->m_regionStorage->SetAsideChunk(m_chunkCoords, buffer);
+        DebuggerPrintf("Chunk (%d, %d): delta saved by generator v%d/%08x, current v%d/%08x, %d edits not applied (%s)\n",
+            m_chunkCoords.x, m_chunkCoords.y, (int)deltaHeader.m_generatorVersion, deltaHeader.m_generatorHash,
+            (int)WORLD_GEN_VERSION, m_generatorHash, (int)edits.size(), isSetAside ? "moved to SetAside" : "kept in place");
+        m_hasRefusedDelta = !isSetAside;
+        MarkMeshDirty();
+        m_needsSaving = false;
+        m_savesFullBlocks = false;
+        return true;
+    }
+    for (auto const& [blockIndex, type] : edits)
+    {
+        uint8_t generatedType = m_buildBlocks[blockIndex].m_typeIndex;
+        m_buildBlocks[blockIndex].SetType(type);
+        IntVec3 local = IndexToLocalCoords(blockIndex);
+        UpdateColumnHeight(local.x, local.y, local.z);
+        if (generatedType != type)
+        {
+            ChunkBlockEdit edit;
+            edit.m_generatedType = generatedType;
+            edit.m_currentType = type;
+            m_blockEdits[blockIndex] = edit;
+        }
+    }
+
+    MarkMeshDirty();
     m_needsSaving = false;
+    m_savesFullBlocks = false;
     return true;
 }
 
+void Chunk::RecordBlockEdit(int blockIndex, uint8_t previousType)
+{
+    uint8_t currentType = ReadBlock(blockIndex).m_typeIndex;
+    auto it = m_blockEdits.find((uint16_t)blockIndex);
+    if (it == m_blockEdits.end())
+    {
+        ChunkBlockEdit edit;
+        edit.m_generatedType = previousType;
+        edit.m_currentType = currentType;
+        m_blockEdits[(uint16_t)blockIndex] = edit;
+    }
+    else if (it->second.m_generatedType == currentType)
+    {
+        // 改回了生成时的样子，不再算改动
+        m_blockEdits.erase(it);
+    }
+    else
+    {
+        it->second.m_currentType = currentType;
+    }
+}
+
 std::string Chunk::MakeChunkFilename(const IntVec2& chunkCoords)
 {
     char name[64];
@@ -768,31 +1214,19 @@ void Chunk::GenerateBlocks()
     //     delete m_indexBuffer;
     //     m_indexBuffer = nullptr;
     // }
-    if (!m_world->m_worldGenPipeline)
-    {
-        m_world->m_worldGenPipeline = new WorldGenPipeline();
-    }
-    
-    m_world->m_worldGenPipeline->GenerateChunk(this);
+    // 管线和开关都是世界构造时按 WorldGen.dat 锁定的，不跟着 ImGui 里当前的设置走
+    m_world->m_worldGenPipeline->GenerateChunk(this, m_world->m_genOptions);
+    m_generatorHash = m_world->m_generatorHash;
 
     //InitializeLighting();
     
-    m_isDirty = true;
-    m_needsSaving = true;
+    MarkMeshDirty();
+    m_needsSaving = !g_theGame->g_saveOnlyPlayerEdits;
 }
 
 bool Chunk::GenerateMesh()
 {
-    bool allNeighborsActive = true;
-    
-    if (!m_eastNeighbor || m_eastNeighbor->GetState() != ChunkState::ACTIVE)
-        allNeighborsActive = false;
-    if (!m_westNeighbor || m_westNeighbor->GetState() != ChunkState::ACTIVE)
-        allNeighborsActive = false;
-    if (!m_northNeighbor || m_northNeighbor->GetState() != ChunkState::ACTIVE)
-        allNeighborsActive = false;
-    if (!m_southNeighbor || m_southNeighbor->GetState() != ChunkState::ACTIVE)
-        allNeighborsActive = false;
+    bool allNeighborsActive = AreAllNeighborsActive();
     
     if (!allNeighborsActive)
     {
@@ -804,41 +1238,30 @@ bool Chunk::GenerateMesh()
     //DebuggerPrintf("  Chunk (%d, %d) generating mesh - SUCCESS\n", 
       //             m_chunkCoords.x, m_chunkCoords.y);
     
-    m_vertices.clear();
-    m_indices.clear();
-
-    BlockIterator iter(this, 0);
-    for (int blockIndex = 0; blockIndex < CHUNK_TOTAL_BLOCKS; blockIndex++)
-    {
-        iter = BlockIterator(this, blockIndex);
-        
-        if (!iter.IsValid() || iter.GetBlockType() == BLOCK_TYPE_AIR)
-            continue;
-        
-        const BlockDefinition& blockDef = BlockDefinition::GetBlockDef(iter.GetBlockType());
-        
-        if (!blockDef.m_isVisible)
-            continue;
-        
-        for (int dir = 0; dir < NUM_DIRECTIONS; dir++)
-        {
-            Direction direction = (Direction)dir;
-            
-            if (ShouldRenderFace(iter, direction))
-            {
-                AddFaceToMesh(iter.GetLocalCoords(), blockDef, direction);
-            }
-        }
-    }
-    UpdateVBOIBO();
-    m_isDirty = false;
+    // 同步版本：和 MeshChunkJob 走同一套快照 + ChunkMesher，同样只重建脏的 section
+    CompactDirtySections();
+    ChunkMeshSnapshot* snapshot = ChunkMeshScratchPool::AcquireSnapshot();
+    snapshot->CopyFrom(this, m_dirtySections);
+    ChunkMeshData* mesh = ChunkMeshScratchPool::AcquireMeshData();
+    ChunkMesher::BuildMesh(*snapshot, *mesh, g_theGame->g_useGreedyMeshing ? ChunkMeshMode::GREEDY : ChunkMeshMode::STANDARD, m_dirtySections);
+    ChunkMeshScratchPool::ReleaseSnapshot(snapshot);
+
+    m_dirtySections = 0;
     m_needsImmediateRebuild = false;
-
-    GenerateDebug();
-    m_needsSaving = true;
+    ApplyMesh(*mesh);
+    ChunkMeshScratchPool::ReleaseMeshData(mesh);
     return true;
 }
 
+void Chunk::ApplyMesh(ChunkMeshData& mesh)
+{
+    UpdateSectionBuffers(mesh);
+    m_hasBuiltMesh = true;
+    // 线框只和 chunk 边界有关，建一次就够，不随每次局部重建重做
+    if (!m_vertexBufferDebug)
+        GenerateDebug();
+}
+
 void Chunk::GenerateDebug()
 {
     m_verticesDebug.clear();
@@ -859,141 +1282,6 @@ void Chunk::GenerateDebug()
     g_theRenderer->CopyCPUToGPU(m_indicesDebug.data(), (unsigned int)(m_indicesDebug.size() * sizeof(unsigned int)), m_indexBufferDebug);
 }
 
-bool Chunk::ShouldRenderFace(const BlockIterator& iter, Direction direction)
-{
-    BlockIterator neighbor = iter.GetNeighborCrossBoundary(direction);
-    
-    if (!neighbor.IsValid())
-        return true;
-    
-    Block* neighborBlock = neighbor.GetBlock();
-    if (!neighborBlock)
-        return true;
-    if (neighborBlock->m_typeIndex == BLOCK_TYPE_AIR)
-        return true;
-    
-    if (neighborBlock->IsOpaque())
-        return false;
-    
-    BlockDefinition const& neighborDef = BlockDefinition::GetBlockDef(neighborBlock->m_typeIndex);
-    if (!neighborDef.m_isOpaque)
-        return true;
-    
-    return false;
-
-    // IntVec3 localCoords = iter.GetLocalCoords();
-    //
-    // BlockIterator neighbor = iter.GetNeighbor(direction);
-    //
-    // if (neighbor.IsValid())
-    // {
-    //     return neighbor.IsTransparent();
-    // }
-    // if (IsOnBoundary(localCoords, direction))
-    // {
-    //     Chunk* neighborChunk = GetNeighbor(direction);
-    //     if (neighborChunk)
-    //     {
-    //         IntVec3 neighborLocalCoords = GetNeighborBlockCoords(localCoords, direction);
-    //         BlockIterator neighborIter(neighborChunk, neighborLocalCoords);
-    //         
-    //         if (neighborIter.IsValid())
-    //         {
-    //             return neighborIter.IsTransparent();
-    //         }
-    //         else
-    //         {
-    //             return true;
-    //         }
-    //     }
-    //     else
-    //     {
-    //         return true;
-    //     }
-    // }
-    //
-    // return true;
-}
-
-IntVec3 Chunk::GetNeighborBlockCoords(const IntVec3& localCoords, Direction dir)
-{
-    switch (dir)
-    {
-    case DIRECTION_EAST:  return IntVec3(0, localCoords.y, localCoords.z);
-    case DIRECTION_WEST:  return IntVec3(CHUNK_SIZE_X - 1, localCoords.y, localCoords.z);
-    case DIRECTION_NORTH: return IntVec3(localCoords.x, 0, localCoords.z);
-    case DIRECTION_SOUTH: return IntVec3(localCoords.x, CHUNK_SIZE_Y - 1, localCoords.z);
-    default:
-            return localCoords;
-    }
-}
-
-void Chunk::AddFaceToMesh(const IntVec3& localCoords, const BlockDefinition& blockDef, Direction direction)
-{
-    BlockIterator iter(this, GetBlockLocalIndexFromLocalCoords(localCoords.x, localCoords.y, localCoords.z));
-    BlockIterator neighbor = iter.GetNeighborCrossBoundary(direction);
-    
-    // 获取邻居的光照值（如果没有邻居，使用默认值）
-    uint8_t neighborOutdoorLight = 15;  
-    uint8_t neighborIndoorLight = 0;
-    
-    if (neighbor.IsValid())
-    {
-        neighborOutdoorLight = neighbor.GetOutdoorLight();
-        neighborIndoorLight = neighbor.GetIndoorLight();
-    }
-    
-    float outdoorInfluence = (float)neighborOutdoorLight / 15.0f;
-    float indoorInfluence = (float)neighborIndoorLight / 15.0f;
-    
-    float directionGrayscale = 1.0f;
-    switch (direction)
-    {
-        case DIRECTION_EAST:  directionGrayscale = 0.9f;  break;
-        case DIRECTION_WEST:  directionGrayscale = 0.8f;  break;
-        case DIRECTION_NORTH: directionGrayscale = 0.85f; break;
-        case DIRECTION_SOUTH: directionGrayscale = 0.75f; break;
-        case DIRECTION_UP:    directionGrayscale = 1.0f;  break;
-        case DIRECTION_DOWN:  directionGrayscale = 0.7f;  break;
-    }
-    
-    Vec3 blockWorldPos(
-        (float)(m_chunkCoords.x * CHUNK_SIZE_X + localCoords.x),
-        (float)(m_chunkCoords.y * CHUNK_SIZE_Y + localCoords.y),
-        (float)localCoords.z
-    );
-    
-    const int* faceIndices = GetFaceIndices(direction);
-    size_t startVertIndex = m_vertices.size();
-    
-    for (int i = 0; i < 4; i++)
-    {
-        int vertIndex = faceIndices[i];
-        Vertex_PCUTBN vert = blockDef.m_verts[vertIndex];
-        
-        // 更新位置到世界坐标
-        vert.m_position += blockWorldPos;
-        
-        // 设置顶点颜色：R=室外光，G=室内光，B=方向灰度
-        vert.m_color = Rgba8(
-            (unsigned char)(outdoorInfluence * 255.0f),
-            (unsigned char)(indoorInfluence * 255.0f),
-            (unsigned char)(directionGrayscale * 255.0f),
-            255
-        );
-        
-        m_vertices.push_back(vert);
-    }
-    
-    m_indices.push_back((unsigned int)(startVertIndex + 0));
-    m_indices.push_back((unsigned int)(startVertIndex + 1));
-    m_indices.push_back((unsigned int)(startVertIndex + 2));
-    
-    m_indices.push_back((unsigned int)(startVertIndex + 0));
-    m_indices.push_back((unsigned int)(startVertIndex + 2));
-    m_indices.push_back((unsigned int)(startVertIndex + 3));
-}
-
 const int* Chunk::GetFaceIndices(Direction direction)
 {
     //in block def
@@ -1017,40 +1305,51 @@ const int* Chunk::GetFaceIndices(Direction direction)
     }
 }
 
-void Chunk::UpdateVBOIBO()
+void Chunk::UpdateSectionBuffers(ChunkMeshData const& mesh)
 {
-    if (m_vertices.empty())
-    {
-        DebuggerPrintf("Has no vertices!\n");
-        return;
-    }
-       
-    if (m_vertexBuffer)
-    {
-        delete m_vertexBuffer;
-        m_vertexBuffer = nullptr;
-    }
-    if (m_indexBuffer)
+    // 新建缓冲时多留 64 个 quad，挖/放让段内面数小幅增加时不用重新分配
+    constexpr unsigned int SECTION_SLACK_VERTICES = 64 * CHUNK_VERTS_PER_QUAD;
+
+    unsigned int firstVertex = 0;
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
     {
-        delete m_indexBuffer;
-        m_indexBuffer = nullptr;
-    }
+        if (!(mesh.m_sectionMask & (1 << section)))
+            continue;
 
-    m_vertexBuffer = g_theRenderer->CreateVertexBuffer((unsigned int)(m_vertices.size() * sizeof(Vertex_PCUTBN)),
-                                                       sizeof(Vertex_PCUTBN));
-    m_indexBuffer = g_theRenderer->CreateIndexBuffer((unsigned int)(m_indices.size() * sizeof(unsigned int)),
-                                                     sizeof(unsigned int));
-    
-    g_theRenderer->CopyCPUToGPU(m_vertices.data(),(unsigned int)(m_vertices.size() * sizeof(Vertex_PCUTBN)),m_vertexBuffer);
-    g_theRenderer->CopyCPUToGPU(m_indices.data(), (unsigned int)(m_indices.size() * sizeof(unsigned int)),m_indexBuffer);
+        ChunkSectionMesh& sectionMesh = m_sectionMeshes[section];
+        unsigned int numVertices = mesh.m_sectionVertexCounts[section];
+        ChunkVertex const* vertices = mesh.m_vertices.data() + firstVertex;
+        firstVertex += numVertices;
+
+        m_numMeshVertices -= sectionMesh.m_numVertices;
+        sectionMesh.m_numVertices = numVertices;
+        m_numMeshVertices += numVertices;
+        if (numVertices == 0)
+        {
+            // 变空的段释放缓冲，整段空气的 chunk 上半部分不占显存
+            delete sectionMesh.m_vertexBuffer;
+            sectionMesh = ChunkSectionMesh();
+            continue;
+        }
+
+        if (numVertices > sectionMesh.m_capacityVertices)
+        {
+            delete sectionMesh.m_vertexBuffer;
+            sectionMesh.m_capacityVertices = numVertices + SECTION_SLACK_VERTICES;
+            sectionMesh.m_vertexBuffer = g_theRenderer->CreateVertexBuffer(sectionMesh.m_capacityVertices * (unsigned int)sizeof(ChunkVertex),
+                                                                           sizeof(ChunkVertex));
+        }
+        g_theRenderer->CopyCPUToGPU(vertices, numVertices * (unsigned int)sizeof(ChunkVertex), sectionMesh.m_vertexBuffer);
+
+        // 没有逐 chunk 的索引缓冲，确保共享的 quad 索引够这一段用
+        m_world->EnsureQuadIndexCapacity(numVertices / CHUNK_VERTS_PER_QUAD);
+    }
 }
 
 bool Chunk::AreAllNeighborsActive() const
 {
-    return (m_eastNeighbor && m_eastNeighbor->GetState() == ChunkState::ACTIVE) &&
-          (m_westNeighbor && m_westNeighbor->GetState() == ChunkState::ACTIVE) &&
-          (m_northNeighbor && m_northNeighbor->GetState() == ChunkState::ACTIVE) &&
-          (m_southNeighbor && m_southNeighbor->GetState() == ChunkState::ACTIVE);
+    // 邻居只在激活（ACTIVE）后才会连上，连接/断开时维护这个掩码
+    return m_readyNeighborMask == CHUNK_ALL_NEIGHBORS_MASK;
 }
 
 void Chunk::ReportDirty()
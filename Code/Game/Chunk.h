@@ -4,6 +4,9 @@
 
 #include "Block.h"
 //#include "BlockIterator.h"
+#include "ChunkLightQueue.h"
+#include "ChunkMesher.h"
+#include "ChunkSection.h"
 #include "ChunkSerializer.h"
 #include "Gamecommon.hpp"
 #include "Engine/Math/AABB3.hpp"
@@ -14,6 +17,16 @@
 class World;
 class BlockIterator;
 
+constexpr uint8_t CHUNK_ALL_NEIGHBORS_MASK = 0x0F;   // 1 << Direction，EAST/WEST/NORTH/SOUTH 四位
+
+// 一个 section 的 GPU 网格。挖/放只替换改到的那几段；容量留了余量，顶点数不超过容量时原地覆盖，不重新建缓冲
+struct ChunkSectionMesh
+{
+    VertexBuffer* m_vertexBuffer = nullptr;
+    unsigned int m_numVertices = 0;
+    unsigned int m_capacityVertices = 0;
+};
+
 enum class ChunkState : int
 {
     UNINITIALIZED,           // 初始状态
@@ -36,6 +49,9 @@ class Chunk
     friend class GenerateChunkJob;
     friend class LoadChunkJob;
     friend class SaveChunkJob;
+    friend class MeshChunkJob;
+    friend class LightChunkJob;
+    friend struct ChunkMeshSnapshot;
     
     friend class FeaturePlacer;
     friend class WorldGenPipeline;
@@ -43,8 +59,46 @@ class Chunk
 public:
     Chunk(World* owner, IntVec2 chunkCoords);
     ~Chunk();
+    void ResetForReuse(IntVec2 chunkCoords);
+    void ReleaseRenderResources();
+    void ReleaseSectionArrays();
 
     void InitializeLighting();
+    void ComputeInteriorLighting();
+    void MarkBoundaryLightingDirty(Direction dir);
+    void MarkSkyColumns();
+    void CaptureLightStamp();
+    uint32_t HashBorderFace(Direction dir) const;
+    uint32_t HashBorderOpacity(Direction dir, int section) const;
+
+    // 高度图：每列最高不透明方块的 z（整列透明为 -1），它上面的方块都是天空
+    int GetColumnHeight(int localX, int localY) const { return m_heightMap[localX | (localY << CHUNK_BITS_X)]; }
+    bool IsSkyColumnAt(int localX, int localY, int localZ) const { return localZ > GetColumnHeight(localX, localY); }
+    void RebuildHeightMap();
+    int UpdateColumnHeight(int localX, int localY, int localZ);
+
+    // 方块读写：生成/加载期间走连续的构建缓冲，之后走 section；WriteBlock 会把整段相同的 section 展开
+    inline Block const& ReadBlock(int blockIndex) const
+    {
+        if (m_buildBlocks)
+            return m_buildBlocks[blockIndex];
+        return m_sections[blockIndex >> CHUNK_SECTION_INDEX_BITS].GetBlock(blockIndex & CHUNK_SECTION_INDEX_MASK);
+    }
+    Block& WriteBlock(int blockIndex);
+    ChunkSection const* GetSections() const { return m_sections; }   // CHUNK_NUM_SECTIONS 个，从下往上
+    Block const* GetSectionBlocks(int section) const;   // 该段连续的 4096 个方块，整段相同时为 nullptr
+    Block const& GetSectionUniformBlock(int section) const;
+    void CopyBlocksTo(Block* outBlocks) const;
+    void BeginBuild();
+    void EndBuild();
+    size_t GetBlockMemoryBytes() const;
+    int GetNumUniformSections() const;
+    void CompactDirtySections();
+
+    // 网格脏标记按 section 记
+    bool IsMeshDirty() const { return m_dirtySections != 0; }
+    void MarkMeshDirty() { m_dirtySections = CHUNK_ALL_SECTIONS_MASK; }
+    void MarkBlockMeshDirty(int localZ);
 
     int GetBlockLocalIndexFromLocalCoords(int x, int y, int z) const;
     void GetLocalCoordsFromIndex(int index, int& x, int& y, int& z) const; //index -> local coords
@@ -75,10 +129,14 @@ public:
     void ReportDirty();
 
     // save
-    void Save();
+    bool Save();    // 写 region 失败时返回 false，m_needsSaving 保持为 true
     bool Load();
     static std::string MakeChunkFilename(const IntVec2& chunkCoords);
 
+    // mesh
+    void ApplyMesh(ChunkMeshData& mesh);
+    static const int* GetFaceIndices(Direction direction);
+
     //state
     ChunkState GetState() const { return m_state.load(); }
     void SetState(ChunkState newState) { m_state.store(newState); }
@@ -88,25 +146,48 @@ public:
     
 protected:
     void GenerateBlocks();
+    bool LoadFromDelta(const std::vector<uint8_t>& buffer);
+    void RecordBlockEdit(int blockIndex, uint8_t previousType);
     bool GenerateMesh();
     void GenerateDebug();
-    bool ShouldRenderFace(const BlockIterator& iter, Direction direction);
-    void AddFaceToMesh(const IntVec3& localCoords, const BlockDefinition& blockDef, Direction direction);
-    const int* GetFaceIndices(Direction direction);
-    IntVec3 GetNeighborBlockCoords(const IntVec3& localCoords, Direction dir);
-    void UpdateVBOIBO();
+    void UpdateSectionBuffers(ChunkMeshData const& mesh);
     bool AreAllNeighborsActive() const;
 
 protected:
     ChunkSerializer* m_serializer;
-    Block m_blocks[CHUNK_TOTAL_BLOCKS];
+    ChunkSection m_sections[CHUNK_NUM_SECTIONS];
+    Block* m_buildBlocks = nullptr;   // 生成/加载时 worker 上用的连续缓冲，EndBuild 打包进 section 后归还
+    int8_t m_heightMap[CHUNK_NUM_COLUMNS] = {};  // 生成/加载时建好，挖/放时增量维护
     World* m_world = nullptr;
     IntVec2 m_chunkCoords;
     bool m_needsSaving = false;
     bool m_needsImmediateRebuild = false;
 
+    // 玩家改动（相对生成器输出），edit-tracking 模式下只存这些
+    std::map<uint16_t, ChunkBlockEdit> m_blockEdits;
+    bool m_savesFullBlocks = false;  // 从完整存档加载的 chunk 继续按完整格式保存
+    uint32_t m_generatorHash = 0;    // 生成底图时的 WorldGenOptions::ComputeGeneratorHash，写进 delta 头
+    bool m_hasRefusedDelta = false;  // 生成器对不上的 delta 没能搬到 SetAside/：这个 chunk 不再写盘，免得覆盖唯一的原件
+
     std::atomic<ChunkState> m_state{ChunkState::UNINITIALIZED};
 
+    ChunkLightQueue m_lightQueue;        // 本 chunk 待重算光照的方块
+    bool m_isInLightWorkList = false;    // 已在 World::m_lightDirtyChunks 里
+    bool m_hasUrgentLight = false;       // 挖/放改动的光照，排在最前面处理
+    bool m_lightJobPending = false;      // 队列交给了 LightChunkJob，期间新标记先攒着，主线程不处理
+    uint32_t m_lightJobSerial = 0;
+    bool m_hasInteriorLighting = false;  // 生成/加载时已在 worker 上算好内部光照，激活只需对齐边界
+    ChunkLightStamp m_lightStamp;        // 存档光照的凭据：保存前在主线程抓取，加载时由 ChunkSerializer 读回
+
+    // 邻居就绪：四位齐了才第一次建网格，凑齐的那一刻进 World 的就绪队列
+    uint8_t m_readyNeighborMask = 0;     // 1 << Direction：该侧邻居已连接
+    bool m_isInMeshReadyQueue = false;
+    double m_meshReadyTime = 0.0;        // 进就绪队列的时刻，等光照对齐有上限
+    bool m_hasBuiltMesh = false;         // 建过网格；之后邻居离开也保留现有网格
+    // 邻居离开时记下它贴着本 chunk 那一面每个 section 的不透明哈希；它回来时只有哈希变了的 section 才重建
+    uint8_t m_departedBorderMask = 0;    // 1 << Direction
+    uint32_t m_departedBorderHashes[4][CHUNK_NUM_SECTIONS] = {};
+
     Chunk* m_northNeighbor = nullptr; 
     Chunk* m_southNeighbor = nullptr; 
     Chunk* m_eastNeighbor = nullptr;  
@@ -114,11 +195,11 @@ protected:
 
     AABB3 m_bounds;
 
-    VertexBuffer* m_vertexBuffer = nullptr;
-    IndexBuffer* m_indexBuffer = nullptr;
-    std::vector<Vertex_PCUTBN> m_vertices;
-    std::vector<unsigned int> m_indices;
-    bool m_isDirty = true;
+    ChunkSectionMesh m_sectionMeshes[CHUNK_NUM_SECTIONS];
+    unsigned int m_numMeshVertices = 0;  // 各 section 之和；上传后 CPU 端不留顶点，索引用 World 共享的 quad 索引缓冲
+    uint8_t m_dirtySections = CHUNK_ALL_SECTIONS_MASK;   // 每个 section 一位，有位置 1 就要重建网格
+    bool m_meshJobPending = false;   // 有 MeshChunkJob 在 worker 上，期间不重复提交
+    uint32_t m_meshJobSerial = 0;    // 只接收最新一次提交的结果
 
     VertexBuffer* m_vertexBufferDebug = nullptr;
     IndexBuffer* m_indexBufferDebug = nullptr;
@@ -0,0 +1,100 @@
+﻿#include "ChunkIndex.h"
+
+#include "Chunk.h"
+
+void ChunkIndex::Insert(IntVec2 const& coords, Chunk* chunk)
+{
+    if (!chunk)
+        return;
+
+    Slot* existing = FindSlot(coords);
+    if (existing)
+    {
+        // 同一坐标重复激活：替换指针，列表位置不变
+        existing->m_chunk = chunk;
+        m_chunkList[existing->m_listIndex] = chunk;
+        return;
+    }
+
+    Slot newSlot;
+    newSlot.m_coords = coords;
+    newSlot.m_chunk = chunk;
+    newSlot.m_listIndex = (int)m_chunkList.size();
+    m_chunkList.push_back(chunk);
+
+    Slot& gridSlot = m_grid[GetGridIndex(coords)];
+    if (!gridSlot.m_chunk)
+    {
+        gridSlot = newSlot;
+    }
+    else
+    {
+        m_overflow[MakeKey(coords)] = newSlot;
+    }
+}
+
+void ChunkIndex::Remove(IntVec2 const& coords)
+{
+    Slot* slot = FindSlot(coords);
+    if (!slot)
+        return;
+
+    // swap-and-pop，并修正被搬动 Chunk 的列表下标
+    int removedIndex = slot->m_listIndex;
+    int lastIndex = (int)m_chunkList.size() - 1;
+    if (removedIndex != lastIndex)
+    {
+        Chunk* moved = m_chunkList[lastIndex];
+        m_chunkList[removedIndex] = moved;
+        Slot* movedSlot = FindSlot(moved->GetThisChunkCoords());
+        if (movedSlot)
+            movedSlot->m_listIndex = removedIndex;
+    }
+    m_chunkList.pop_back();
+
+    int gridIndex = GetGridIndex(coords);
+    Slot& gridSlot = m_grid[gridIndex];
+    if (gridSlot.m_chunk && gridSlot.m_coords == coords)
+    {
+        gridSlot = Slot();
+        PromoteOverflowInto(gridIndex);
+    }
+    else
+    {
+        m_overflow.erase(MakeKey(coords));
+    }
+}
+
+void ChunkIndex::Clear()
+{
+    for (Slot& slot : m_grid)
+    {
+        slot = Slot();
+    }
+    m_overflow.clear();
+    m_chunkList.clear();
+}
+
+ChunkIndex::Slot* ChunkIndex::FindSlot(IntVec2 const& coords)
+{
+    Slot& gridSlot = m_grid[GetGridIndex(coords)];
+    if (gridSlot.m_chunk && gridSlot.m_coords == coords)
+        return &gridSlot;
+
+    auto it = m_overflow.find(MakeKey(coords));
+    return it != m_overflow.end() ? &it->second : nullptr;
+}
+
+void ChunkIndex::PromoteOverflowInto(int gridIndex)
+{
+    // 格子空出来后，把映射到同一格子的溢出项搬回网格，保持热路径只查一次
+    for (auto it = m_overflow.begin(); it != m_overflow.end(); ++it)
+    {
+        if (GetGridIndex(it->second.m_coords) == gridIndex)
+        {
+            m_grid[gridIndex] = it->second;
+            m_overflow.erase(it);
+            return;
+        }
+    }
+}
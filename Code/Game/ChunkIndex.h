@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Gamecommon.hpp"
+#include "Engine/Math/IntVec2.hpp"
+
+class Chunk;
+
+// 激活 Chunk 的空间索引：
+// 环形(toroidal)稠密网格，坐标取模后直接寻址。网格边长大于停用范围的直径，
+// 所以同时处在停用范围内的两个 Chunk 不会取模到同一格；但格子仍可能被占：
+// 玩家移动后，远处还没来得及停用的 Chunk 会和新进入范围的 Chunk 落在同一格。
+// Insert 遇到格子已被占用时把新 Chunk 放进哈希表 m_overflow，Find 先查网格再查这张表；
+// 占着格子的 Chunk 被 Remove 后，PromoteOverflowInto 把表里落在这一格的 Chunk 提回网格。
+class ChunkIndex
+{
+public:
+    static constexpr int GRID_BITS = 6;
+    static constexpr int GRID_SIZE = 1 << GRID_BITS;     // 64 x 64
+    static constexpr int GRID_MASK = GRID_SIZE - 1;
+
+    // 停用半径内的 Chunk 必须能放进网格而不互相覆盖
+    static_assert(GRID_SIZE >= 2 * (CHUNK_DEACTIVATION_RANGE / CHUNK_SIZE_X + 2), "ChunkIndex grid too small for deactivation range");
+
+public:
+    ChunkIndex() = default;
+
+    void Insert(IntVec2 const& coords, Chunk* chunk);
+    void Remove(IntVec2 const& coords);
+    void Clear();
+
+    inline Chunk* Find(IntVec2 const& coords) const
+    {
+        Slot const& slot = m_grid[GetGridIndex(coords)];
+        if (slot.m_chunk && slot.m_coords == coords)
+            return slot.m_chunk;
+        if (m_overflow.empty())
+            return nullptr;
+        auto it = m_overflow.find(MakeKey(coords));
+        return it != m_overflow.end() ? it->second.m_chunk : nullptr;
+    }
+    inline bool Contains(IntVec2 const& coords) const { return Find(coords) != nullptr; }
+
+    // 连续数组，遍历时不用走 map 的节点
+    std::vector<Chunk*> const& GetAllChunks() const { return m_chunkList; }
+    int GetNumChunks() const { return (int)m_chunkList.size(); }
+    int GetNumOverflowChunks() const { return (int)m_overflow.size(); }
+
+private:
+    struct Slot
+    {
+        IntVec2 m_coords;
+        Chunk* m_chunk = nullptr;
+        int m_listIndex = -1;
+    };
+
+    static inline int GetGridIndex(IntVec2 const& coords)
+    {
+        return (coords.x & GRID_MASK) | ((coords.y & GRID_MASK) << GRID_BITS);
+    }
+    static inline uint64_t MakeKey(IntVec2 const& coords)
+    {
+        return ((uint64_t)(uint32_t)coords.x << 32) | (uint64_t)(uint32_t)coords.y;
+    }
+
+    Slot* FindSlot(IntVec2 const& coords);
+    void PromoteOverflowInto(int gridIndex);
+
+private:
+    Slot m_grid[GRID_SIZE * GRID_SIZE];
+    std::unordered_map<uint64_t, Slot> m_overflow;
+    std::vector<Chunk*> m_chunkList;
+};
@@ -17,7 +17,10 @@ GenerateChunkJob::GenerateChunkJob(Chunk* chunk)
 void GenerateChunkJob::Execute()
 {
     m_chunk->SetState(ChunkState::GENERATING);
+    m_chunk->BeginBuild();
     m_chunk->GenerateBlocks();
+    m_chunk->ComputeInteriorLighting();
+    m_chunk->EndBuild();
     m_chunk->SetState(ChunkState::GENERATION_COMPLETE);
 }
 
@@ -37,11 +40,17 @@ LoadChunkJob::LoadChunkJob(Chunk* chunk)
 void LoadChunkJob::Execute()
 {
     m_chunk->SetState(ChunkState::LOADING);
+    m_chunk->BeginBuild();
     bool success = m_chunk->Load();
     if (!success)
     {
         m_chunk->GenerateBlocks();
     }
+    if (!m_chunk->m_hasInteriorLighting)
+    {
+        m_chunk->ComputeInteriorLighting();
+    }
+    m_chunk->EndBuild();
     m_chunk->SetState(ChunkState::GENERATION_COMPLETE);
 }
 
@@ -67,8 +76,67 @@ void SaveChunkJob::Execute()
 
 void SaveChunkJob::OnComplete()
 {
-    if (m_chunk->GetState() == ChunkState::GENERATION_COMPLETE)
-    {
-        delete m_chunk; 
-    }
+    // chunk 由 World::ProcessCompletedJobs 回收进 ChunkPool
+}
+
+MeshChunkJob::MeshChunkJob(Chunk* chunk, uint32_t serial, ChunkMeshMode mode, uint8_t sectionMask)
+    : ChunkJob(chunk, JOB_TYPE_WORKER)
+    , m_worldGenerationId(chunk->m_world->m_generationId)
+    , m_chunkCoords(chunk->GetThisChunkCoords())
+    , m_serial(serial)
+    , m_mode(mode)
+    , m_sectionMask(sectionMask)
+{
+    m_snapshot = ChunkMeshScratchPool::AcquireSnapshot();
+    m_snapshot->CopyFrom(chunk, sectionMask);
+}
+
+MeshChunkJob::~MeshChunkJob()
+{
+    ChunkMeshScratchPool::ReleaseSnapshot(m_snapshot);
+    m_snapshot = nullptr;
+    ChunkMeshScratchPool::ReleaseMeshData(m_mesh);
+    m_mesh = nullptr;
+}
+
+void MeshChunkJob::Execute()
+{
+    // 不能碰 m_chunk：执行期间 chunk 可能已经被停用删除
+    m_mesh = ChunkMeshScratchPool::AcquireMeshData();
+    ChunkMesher::BuildMesh(*m_snapshot, *m_mesh, m_mode, m_sectionMask);
+    ChunkMeshScratchPool::ReleaseSnapshot(m_snapshot);
+    m_snapshot = nullptr;
+}
+
+void MeshChunkJob::OnComplete()
+{
+}
+
+LightChunkJob::LightChunkJob(Chunk* chunk, uint32_t serial)
+    : ChunkJob(chunk, JOB_TYPE_WORKER)
+    , m_worldGenerationId(chunk->m_world->m_generationId)
+    , m_chunkCoords(chunk->GetThisChunkCoords())
+    , m_serial(serial)
+{
+    m_snapshot = ChunkMeshScratchPool::AcquireSnapshot();
+    m_snapshot->CopyFrom(chunk);
+    m_queue.Swap(chunk->m_lightQueue);
+}
+
+LightChunkJob::~LightChunkJob()
+{
+    ChunkMeshScratchPool::ReleaseSnapshot(m_snapshot);
+    m_snapshot = nullptr;
+}
+
+void LightChunkJob::Execute()
+{
+    // 和 MeshChunkJob 一样不碰 m_chunk
+    ChunkLighter::PropagateLight(*m_snapshot, m_queue, m_result);
+    ChunkMeshScratchPool::ReleaseSnapshot(m_snapshot);
+    m_snapshot = nullptr;
+}
+
+void LightChunkJob::OnComplete()
+{
 }
@@ -1,7 +1,13 @@
 ﻿#pragma once
+#include <cstdint>
+
+#include "ChunkLighter.h"
+#include "ChunkMesher.h"
 #include "Engine/Job/JobSystem.h"
+#include "Engine/Math/IntVec2.hpp"
 
 class Chunk;
+class World;
 
 class ChunkJob : public Job
 {
@@ -41,4 +47,40 @@ public:
     virtual void OnComplete() override;
 public:
     //Chunk* m_chunk;
-};
\ No newline at end of file
+};
+
+// 主线程构造时拷贝快照，worker 上只读快照建网格；结果由 World::ProcessCompletedJobs 按坐标和序号交回 chunk
+class MeshChunkJob : public ChunkJob
+{
+public:
+    MeshChunkJob(Chunk* chunk, uint32_t serial, ChunkMeshMode mode, uint8_t sectionMask);
+    ~MeshChunkJob();
+    virtual void Execute() override;
+    virtual void OnComplete() override;
+public:
+    uint32_t m_worldGenerationId = 0;
+    IntVec2 m_chunkCoords;
+    uint32_t m_serial = 0;
+    ChunkMeshMode m_mode = ChunkMeshMode::STANDARD;
+    uint8_t m_sectionMask = CHUNK_ALL_SECTIONS_MASK;   // 只重建这些 section
+    ChunkMeshSnapshot* m_snapshot = nullptr;   // 从 ChunkMeshScratchPool 借
+    ChunkMeshData* m_mesh = nullptr;
+};
+
+// 主线程拷快照并接走 chunk 的光照队列，worker 上只在快照里传播；
+// 结果和跨边界的变化由 World::ApplyCompletedLightJob 按坐标和序号合并回 chunk
+class LightChunkJob : public ChunkJob
+{
+public:
+    LightChunkJob(Chunk* chunk, uint32_t serial);
+    ~LightChunkJob();
+    virtual void Execute() override;
+    virtual void OnComplete() override;
+public:
+    uint32_t m_worldGenerationId = 0;
+    IntVec2 m_chunkCoords;
+    uint32_t m_serial = 0;
+    ChunkMeshSnapshot* m_snapshot = nullptr;   // 从 ChunkMeshScratchPool 借
+    ChunkLightQueue m_queue;
+    ChunkLightResult m_result;
+};
@@ -0,0 +1,80 @@
+﻿#include "ChunkLightQueue.h"
+
+#include <cstring>
+#include <utility>
+
+bool ChunkLightQueue::Push(int blockIndex)
+{
+    uint64_t bit = 1ull << (blockIndex & 63);
+    uint64_t& word = m_dirtyBits[blockIndex >> 6];
+    if (word & bit)
+        return false;
+    word |= bit;
+
+    if (m_count == (uint32_t)m_ring.size())
+    {
+        Grow();
+    }
+    uint32_t mask = (uint32_t)m_ring.size() - 1;
+    m_ring[(m_head + m_count) & mask] = (uint16_t)blockIndex;
+    m_count++;
+    return true;
+}
+
+int ChunkLightQueue::Pop()
+{
+    if (m_count == 0)
+        return -1;
+
+    uint32_t mask = (uint32_t)m_ring.size() - 1;
+    int blockIndex = m_ring[m_head];
+    m_head = (m_head + 1) & mask;
+    m_count--;
+    m_dirtyBits[blockIndex >> 6] &= ~(1ull << (blockIndex & 63));
+
+    if (m_count == 0)
+    {
+        m_head = 0;
+        if (m_ring.size() > KEEP_CAPACITY)
+        {
+            std::vector<uint16_t>().swap(m_ring);
+        }
+    }
+    return blockIndex;
+}
+
+void ChunkLightQueue::Clear()
+{
+    if (m_count == 0)
+        return;
+
+    memset(m_dirtyBits, 0, sizeof(m_dirtyBits));
+    m_head = 0;
+    m_count = 0;
+    if (m_ring.size() > KEEP_CAPACITY)
+    {
+        std::vector<uint16_t>().swap(m_ring);
+    }
+}
+
+void ChunkLightQueue::Swap(ChunkLightQueue& other)
+{
+    m_ring.swap(other.m_ring);
+    std::swap(m_head, other.m_head);
+    std::swap(m_count, other.m_count);
+    std::swap(m_dirtyBits, other.m_dirtyBits);
+}
+
+void ChunkLightQueue::Grow()
+{
+    // 按环形顺序搬到新缓冲开头
+    uint32_t oldCapacity = (uint32_t)m_ring.size();
+    uint32_t newCapacity = oldCapacity == 0 ? MIN_CAPACITY : oldCapacity * 2;
+    std::vector<uint16_t> grown(newCapacity);
+    for (uint32_t i = 0; i < m_count; ++i)
+    {
+        grown[i] = m_ring[(m_head + i) & (oldCapacity - 1)];
+    }
+    m_ring.swap(grown);
+    m_head = 0;
+}
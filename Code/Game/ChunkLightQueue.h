@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Gamecommon.hpp"
+
+static_assert(CHUNK_TOTAL_BLOCKS <= (1 << 15), "light queue stores 15-bit local block indices");
+
+// 每个 chunk 自己的待重算光照队列：局部下标(15 位)的环形缓冲 + 去重位图。
+// 停用 chunk 时整个丢掉即可，不用再去全局队列里逐个查找删除。
+class ChunkLightQueue
+{
+public:
+    static constexpr uint32_t MIN_CAPACITY = 256;
+    static constexpr uint32_t KEEP_CAPACITY = 1024;   // 排空后超过这个容量就释放，常驻 chunk 不长期占着大缓冲
+
+public:
+    bool Push(int blockIndex);          // 已在队列里返回 false
+    int Pop();                          // 空时返回 -1
+    void Clear();
+    void Swap(ChunkLightQueue& other);   // 把整个队列交给光照任务
+
+    inline bool Contains(int blockIndex) const
+    {
+        return (m_dirtyBits[blockIndex >> 6] & (1ull << (blockIndex & 63))) != 0;
+    }
+    inline bool IsEmpty() const { return m_count == 0; }
+    inline int GetCount() const { return (int)m_count; }
+    inline size_t GetCapacityBytes() const { return m_ring.capacity() * sizeof(uint16_t); }
+
+private:
+    void Grow();
+
+private:
+    std::vector<uint16_t> m_ring;      // 容量是 2 的幂，按需翻倍，最多 CHUNK_TOTAL_BLOCKS（每个方块至多排一次）
+    uint32_t m_head = 0;
+    uint32_t m_count = 0;
+    uint64_t m_dirtyBits[CHUNK_TOTAL_BLOCKS / 64] = {};
+};
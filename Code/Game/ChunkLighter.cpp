@@ -0,0 +1,159 @@
+﻿#include "ChunkLighter.h"
+
+#include "BlockIterator.h"
+#include "ChunkUtils.h"
+
+namespace
+{
+    constexpr int DIRECTION_OFFSETS[NUM_DIRECTIONS][3] =
+    {
+        { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }
+    };
+
+    // 一条边界面 16 x 128 个方块，按 (沿边坐标, z) 去重
+    constexpr int BORDER_FACE_BLOCKS = CHUNK_SIZE_X * CHUNK_SIZE_Z;
+    static_assert(CHUNK_SIZE_X == CHUNK_SIZE_Y, "border dedupe assumes square chunks");
+}
+
+void ChunkLighter::PropagateLight(ChunkMeshSnapshot& snapshot, ChunkLightQueue& queue, ChunkLightResult& outResult)
+{
+    outResult.m_changedLight.clear();
+    outResult.m_borderDeltas.clear();
+    outResult.m_touchedNeighborMask = 0;
+    outResult.m_numProcessed = 0;
+
+    uint64_t changedBits[CHUNK_TOTAL_BLOCKS / 64] = {};
+    uint64_t borderBits[4][BORDER_FACE_BLOCKS / 64] = {};
+    std::vector<uint16_t> changedIndices;
+
+    for (int blockIndex = queue.Pop(); blockIndex >= 0; blockIndex = queue.Pop())
+    {
+        outResult.m_numProcessed++;
+        IntVec3 local = IndexToLocalCoords(blockIndex);
+        Block& block = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(local.x, local.y, local.z)];
+
+        uint8_t outdoor = 0;
+        uint8_t indoor = 0;
+        ComputeLight(snapshot, local.x, local.y, local.z, outdoor, indoor);
+        if (outdoor == block.GetOutdoorLight() && indoor == block.GetIndoorLight())
+            continue;
+
+        block.SetOutdoorLight(outdoor);
+        block.SetIndoorLight(indoor);
+        uint64_t bit = 1ull << (blockIndex & 63);
+        if (!(changedBits[blockIndex >> 6] & bit))
+        {
+            changedBits[blockIndex >> 6] |= bit;
+            changedIndices.push_back((uint16_t)blockIndex);
+        }
+
+        for (int dir = 0; dir < NUM_DIRECTIONS; ++dir)
+        {
+            int nx = local.x + DIRECTION_OFFSETS[dir][0];
+            int ny = local.y + DIRECTION_OFFSETS[dir][1];
+            int nz = local.z + DIRECTION_OFFSETS[dir][2];
+            if (nz < 0 || nz >= CHUNK_SIZE_Z)
+                continue;
+
+            bool isInside = nx >= 0 && nx < CHUNK_SIZE_X && ny >= 0 && ny < CHUNK_SIZE_Y;
+            if (!isInside)
+            {
+                if (!IsNeighborPresent(snapshot, nx, ny))
+                    continue;
+                outResult.m_touchedNeighborMask |= (uint8_t)(1 << dir);
+            }
+            if (snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(nx, ny, nz)].IsOpaque())
+                continue;
+
+            if (isInside)
+            {
+                queue.Push(LocalCoordsToIndex(nx, ny, nz));
+                continue;
+            }
+
+            // 邻居 chunk 的方块不在这里改，只记下来
+            int along = (dir == DIRECTION_EAST || dir == DIRECTION_WEST) ? ny : nx;
+            int faceIndex = along + nz * CHUNK_SIZE_X;
+            uint64_t& word = borderBits[dir][faceIndex >> 6];
+            uint64_t faceBit = 1ull << (faceIndex & 63);
+            if (word & faceBit)
+                continue;
+            word |= faceBit;
+
+            ChunkLightBorderDelta delta;
+            delta.m_direction = (uint8_t)dir;
+            delta.m_neighborIndex = (uint16_t)LocalCoordsToIndex(nx & CHUNK_MAX_X, ny & CHUNK_MAX_Y, nz);
+            outResult.m_borderDeltas.push_back(delta);
+        }
+    }
+
+    outResult.m_changedLight.reserve(changedIndices.size());
+    for (uint16_t blockIndex : changedIndices)
+    {
+        IntVec3 local = IndexToLocalCoords(blockIndex);
+        uint8_t lightData = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(local.x, local.y, local.z)].m_lightData;
+        outResult.m_changedLight.emplace_back(blockIndex, lightData);
+    }
+}
+
+void ChunkLighter::ComputeLight(ChunkMeshSnapshot const& snapshot, int x, int y, int z, uint8_t& outOutdoorLight, uint8_t& outIndoorLight)
+{
+    outOutdoorLight = 0;
+    outIndoorLight = 0;
+
+    Block const& block = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(x, y, z)];
+    if (block.IsSky())
+    {
+        outOutdoorLight = 15;
+    }
+
+    BlockDefinition const& def = BlockDefinition::GetBlockDef(block.m_typeIndex);
+    if (def.m_indoorLightInfluence > 0)
+    {
+        outIndoorLight = def.m_indoorLightInfluence;
+    }
+    if (def.m_outdoorLightInfluence > 0)
+    {
+        outOutdoorLight = def.m_outdoorLightInfluence;
+    }
+
+    if (block.IsOpaque())
+        return;
+
+    uint8_t maxNeighborOutdoor = 0;
+    uint8_t maxNeighborIndoor = 0;
+    for (int dir = 0; dir < NUM_DIRECTIONS; ++dir)
+    {
+        int nx = x + DIRECTION_OFFSETS[dir][0];
+        int ny = y + DIRECTION_OFFSETS[dir][1];
+        int nz = z + DIRECTION_OFFSETS[dir][2];
+        if (nz < 0 || nz >= CHUNK_SIZE_Z || !IsNeighborPresent(snapshot, nx, ny))
+            continue;
+
+        Block const& neighbor = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(nx, ny, nz)];
+        if (neighbor.GetOutdoorLight() > maxNeighborOutdoor)
+            maxNeighborOutdoor = neighbor.GetOutdoorLight();
+        if (neighbor.GetIndoorLight() > maxNeighborIndoor)
+            maxNeighborIndoor = neighbor.GetIndoorLight();
+    }
+
+    // 光照传播会衰减 1 级
+    if (maxNeighborOutdoor > 0 && maxNeighborOutdoor - 1 > outOutdoorLight)
+        outOutdoorLight = maxNeighborOutdoor - 1;
+    if (maxNeighborIndoor > 0 && maxNeighborIndoor - 1 > outIndoorLight)
+        outIndoorLight = maxNeighborIndoor - 1;
+}
+
+bool ChunkLighter::IsNeighborPresent(ChunkMeshSnapshot const& snapshot, int x, int y)
+{
+    // 缺失的邻居和 GetNeighborCrossBoundary 无效时一样，不参与计算
+    if (x < 0)
+        return (snapshot.m_neighborMask & (1 << DIRECTION_WEST)) != 0;
+    if (x >= CHUNK_SIZE_X)
+        return (snapshot.m_neighborMask & (1 << DIRECTION_EAST)) != 0;
+    if (y < 0)
+        return (snapshot.m_neighborMask & (1 << DIRECTION_SOUTH)) != 0;
+    if (y >= CHUNK_SIZE_Y)
+        return (snapshot.m_neighborMask & (1 << DIRECTION_NORTH)) != 0;
+    return true;
+}
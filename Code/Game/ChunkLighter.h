@@ -0,0 +1,33 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ChunkLightQueue.h"
+#include "ChunkMesher.h"
+
+// 跨 chunk 边界的光照变化：邻居 chunk 里贴边的这个方块需要重算
+struct ChunkLightBorderDelta
+{
+    uint8_t m_direction = 0;        // Direction，邻居在本 chunk 的哪一侧
+    uint16_t m_neighborIndex = 0;   // 邻居 chunk 内的局部下标
+};
+
+struct ChunkLightResult
+{
+    std::vector<std::pair<uint16_t, uint8_t>> m_changedLight;   // (局部下标, 新的 m_lightData)
+    std::vector<ChunkLightBorderDelta> m_borderDeltas;
+    uint8_t m_touchedNeighborMask = 0;   // 1 << Direction：贴着这一侧的方块光照变了，邻居网格要重建
+    int m_numProcessed = 0;
+};
+
+// worker 上的 chunk 内光照传播：规则和 World::ComputeCorrectLightInfluence 一样，
+// 只读写快照；邻居那一圈边界只读，影响到邻居的变化记进 m_borderDeltas 交回主线程合并
+class ChunkLighter
+{
+public:
+    static void PropagateLight(ChunkMeshSnapshot& snapshot, ChunkLightQueue& queue, ChunkLightResult& outResult);
+
+private:
+    static void ComputeLight(ChunkMeshSnapshot const& snapshot, int x, int y, int z, uint8_t& outOutdoorLight, uint8_t& outIndoorLight);
+    static bool IsNeighborPresent(ChunkMeshSnapshot const& snapshot, int x, int y);
+};
@@ -0,0 +1,529 @@
+﻿#include "ChunkMesher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "BlockIterator.h"
+#include "Chunk.h"
+
+std::mutex ChunkMeshScratchPool::s_mutex;
+std::vector<ChunkMeshSnapshot*> ChunkMeshScratchPool::s_freeSnapshots;
+std::vector<ChunkMeshData*> ChunkMeshScratchPool::s_freeMeshData;
+std::vector<Block*> ChunkMeshScratchPool::s_freeBlockBuffers;
+
+ChunkMeshSnapshot* ChunkMeshScratchPool::AcquireSnapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (!s_freeSnapshots.empty())
+        {
+            ChunkMeshSnapshot* snapshot = s_freeSnapshots.back();
+            s_freeSnapshots.pop_back();
+            return snapshot;
+        }
+    }
+    return new ChunkMeshSnapshot();
+}
+
+void ChunkMeshScratchPool::ReleaseSnapshot(ChunkMeshSnapshot* snapshot)
+{
+    if (!snapshot)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if ((int)s_freeSnapshots.size() < MAX_POOLED_ITEMS)
+        {
+            s_freeSnapshots.push_back(snapshot);
+            return;
+        }
+    }
+    delete snapshot;
+}
+
+ChunkMeshData* ChunkMeshScratchPool::AcquireMeshData()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (!s_freeMeshData.empty())
+        {
+            ChunkMeshData* meshData = s_freeMeshData.back();
+            s_freeMeshData.pop_back();
+            return meshData;
+        }
+    }
+    return new ChunkMeshData();
+}
+
+void ChunkMeshScratchPool::ReleaseMeshData(ChunkMeshData* meshData)
+{
+    if (!meshData)
+        return;
+    meshData->m_vertices.clear();
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if ((int)s_freeMeshData.size() < MAX_POOLED_ITEMS)
+        {
+            s_freeMeshData.push_back(meshData);
+            return;
+        }
+    }
+    delete meshData;
+}
+
+Block* ChunkMeshScratchPool::AcquireBlockBuffer()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if (!s_freeBlockBuffers.empty())
+        {
+            Block* blocks = s_freeBlockBuffers.back();
+            s_freeBlockBuffers.pop_back();
+            return blocks;
+        }
+    }
+    return new Block[CHUNK_TOTAL_BLOCKS];
+}
+
+void ChunkMeshScratchPool::ReleaseBlockBuffer(Block* blocks)
+{
+    if (!blocks)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        if ((int)s_freeBlockBuffers.size() < MAX_POOLED_ITEMS)
+        {
+            s_freeBlockBuffers.push_back(blocks);
+            return;
+        }
+    }
+    delete[] blocks;
+}
+
+size_t ChunkMeshScratchPool::GetPooledBytes()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    size_t bytes = s_freeSnapshots.size() * sizeof(ChunkMeshSnapshot);
+    bytes += s_freeBlockBuffers.size() * CHUNK_TOTAL_BLOCKS * sizeof(Block);
+    for (ChunkMeshData const* meshData : s_freeMeshData)
+    {
+        bytes += sizeof(ChunkMeshData) + meshData->m_vertices.capacity() * sizeof(ChunkVertex);
+    }
+    return bytes;
+}
+
+void ChunkMeshScratchPool::Clear()
+{
+    std::lock_guard<std::mutex> lock(s_mutex);
+    for (ChunkMeshSnapshot* snapshot : s_freeSnapshots)
+    {
+        delete snapshot;
+    }
+    s_freeSnapshots.clear();
+    for (ChunkMeshData* meshData : s_freeMeshData)
+    {
+        delete meshData;
+    }
+    s_freeMeshData.clear();
+    for (Block* blocks : s_freeBlockBuffers)
+    {
+        delete[] blocks;
+    }
+    s_freeBlockBuffers.clear();
+}
+
+void ChunkMeshSnapshot::CopyFrom(Chunk const* chunk, uint8_t sectionMask)
+{
+    m_chunkCoords = chunk->m_chunkCoords;
+    m_copiedSectionMask = (uint8_t)((sectionMask | (sectionMask << 1) | (sectionMask >> 1)) & CHUNK_ALL_SECTIONS_MASK);
+
+    // 缺邻居时当成透光的空气：和 GetNeighborCrossBoundary 无效时一样画面、室外光 15
+    Block missing;
+    missing.m_typeIndex = BLOCK_TYPE_AIR;
+    missing.m_lightData = LIGHT_MASK_OUTDOOR;
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        if (!(m_copiedSectionMask & (1 << section)))
+            continue;
+        Block* sectionBegin = &m_blocks[GetIndex(-1, -1, section * CHUNK_SECTION_SIZE_Z)];
+        std::fill(sectionBegin, sectionBegin + MESH_SNAPSHOT_LAYER * CHUNK_SECTION_SIZE_Z, missing);
+    }
+
+    Chunk const* east = chunk->m_eastNeighbor;
+    Chunk const* west = chunk->m_westNeighbor;
+    Chunk const* north = chunk->m_northNeighbor;
+    Chunk const* south = chunk->m_southNeighbor;
+    m_neighborMask = 0;
+    if (east)  m_neighborMask |= 1 << DIRECTION_EAST;
+    if (west)  m_neighborMask |= 1 << DIRECTION_WEST;
+    if (north) m_neighborMask |= 1 << DIRECTION_NORTH;
+    if (south) m_neighborMask |= 1 << DIRECTION_SOUTH;
+
+    // 本 chunk 按 section 拷：展开的段逐行 memcpy，整段相同的直接填
+    m_emptySectionMask = 0;
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        if (!(m_copiedSectionMask & (1 << section)))
+            continue;
+        Block const* sectionBlocks = chunk->GetSectionBlocks(section);
+        Block const& uniformBlock = chunk->GetSectionUniformBlock(section);
+        if (!sectionBlocks && !BlockDefinition::GetBlockDef(uniformBlock.m_typeIndex).m_isVisible)
+        {
+            m_emptySectionMask |= (uint8_t)(1 << section);
+        }
+        for (int zInSection = 0; zInSection < CHUNK_SECTION_SIZE_Z; ++zInSection)
+        {
+            int z = section * CHUNK_SECTION_SIZE_Z + zInSection;
+            for (int y = 0; y < CHUNK_SIZE_Y; ++y)
+            {
+                Block* dstRow = &m_blocks[GetIndex(0, y, z)];
+                if (sectionBlocks)
+                {
+                    int srcRow = (y << CHUNK_BITS_X) | (zInSection << CHUNK_BITS_XY);
+                    memcpy(dstRow, &sectionBlocks[srcRow], CHUNK_SIZE_X * sizeof(Block));
+                }
+                else
+                {
+                    std::fill(dstRow, dstRow + CHUNK_SIZE_X, uniformBlock);
+                }
+            }
+        }
+    }
+
+    for (int z = 0; z < CHUNK_SIZE_Z; ++z)
+    {
+        if (!(m_copiedSectionMask & (1 << (z >> CHUNK_SECTION_BITS_Z))))
+        {
+            z += CHUNK_SECTION_SIZE_Z - 1;
+            continue;
+        }
+        for (int y = 0; y < CHUNK_SIZE_Y; ++y)
+        {
+            int srcRow = (y << CHUNK_BITS_X) | (z << CHUNK_BITS_XY);
+            if (east)
+                m_blocks[GetIndex(CHUNK_SIZE_X, y, z)] = east->ReadBlock(srcRow);
+            if (west)
+                m_blocks[GetIndex(-1, y, z)] = west->ReadBlock(srcRow + CHUNK_MAX_X);
+        }
+
+        int northRow = z << CHUNK_BITS_XY;
+        int southRow = (CHUNK_MAX_Y << CHUNK_BITS_X) | (z << CHUNK_BITS_XY);
+        for (int x = 0; x < CHUNK_SIZE_X; ++x)
+        {
+            if (north)
+                m_blocks[GetIndex(x, CHUNK_SIZE_Y, z)] = north->ReadBlock(northRow + x);
+            if (south)
+                m_blocks[GetIndex(x, -1, z)] = south->ReadBlock(southRow + x);
+        }
+    }
+}
+
+void ChunkMesher::BuildMesh(ChunkMeshSnapshot const& snapshot, ChunkMeshData& outMesh, ChunkMeshMode mode, uint8_t sectionMask)
+{
+    outMesh.m_vertices.clear();
+    outMesh.m_sectionMask = (uint8_t)(sectionMask & snapshot.m_copiedSectionMask);
+
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        outMesh.m_sectionVertexCounts[section] = 0;
+        if (!(outMesh.m_sectionMask & (1 << section)))
+            continue;
+        // 整段空气没有要画的面
+        if (snapshot.m_emptySectionMask & (1 << section))
+            continue;
+
+        size_t firstVertex = outMesh.m_vertices.size();
+        int zBegin = section * CHUNK_SECTION_SIZE_Z;
+        int zEnd = zBegin + CHUNK_SECTION_SIZE_Z;
+        if (mode == ChunkMeshMode::GREEDY)
+            BuildGreedyMesh(snapshot, zBegin, zEnd, outMesh);
+        else
+            BuildStandardMesh(snapshot, zBegin, zEnd, outMesh);
+        outMesh.m_sectionVertexCounts[section] = (uint32_t)(outMesh.m_vertices.size() - firstVertex);
+    }
+}
+
+void ChunkMesher::BuildStandardMesh(ChunkMeshSnapshot const& snapshot, int zBegin, int zEnd, ChunkMeshData& outMesh)
+{
+    // 遍历顺序和原来 Chunk::GenerateMesh 一样（x 最快，然后 y、z），输出的顶点顺序不变
+    for (int z = zBegin; z < zEnd; ++z)
+    {
+        for (int y = 0; y < CHUNK_SIZE_Y; ++y)
+        {
+            for (int x = 0; x < CHUNK_SIZE_X; ++x)
+            {
+                Block const& block = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(x, y, z)];
+                if (block.m_typeIndex == BLOCK_TYPE_AIR)
+                    continue;
+
+                BlockDefinition const& blockDef = BlockDefinition::GetBlockDef(block.m_typeIndex);
+                if (!blockDef.m_isVisible)
+                    continue;
+
+                for (int dir = 0; dir < NUM_DIRECTIONS; dir++)
+                {
+                    Direction direction = (Direction)dir;
+                    if (ShouldRenderFace(snapshot, x, y, z, direction))
+                    {
+                        AddFace(snapshot, x, y, z, blockDef, direction, outMesh);
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool ChunkMesher::GetNeighborBlock(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction, Block& outBlock)
+{
+    switch (direction)
+    {
+    case DIRECTION_EAST:  x++; break;
+    case DIRECTION_WEST:  x--; break;
+    case DIRECTION_NORTH: y++; break;
+    case DIRECTION_SOUTH: y--; break;
+    case DIRECTION_UP:    z++; break;
+    case DIRECTION_DOWN:  z--; break;
+    default: return false;
+    }
+
+    // 世界上下边界外没有方块
+    if (z < 0 || z >= CHUNK_SIZE_Z)
+        return false;
+
+    outBlock = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(x, y, z)];
+    return true;
+}
+
+bool ChunkMesher::ShouldRenderFace(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction)
+{
+    Block neighborBlock;
+    if (!GetNeighborBlock(snapshot, x, y, z, direction, neighborBlock))
+        return true;
+    if (neighborBlock.m_typeIndex == BLOCK_TYPE_AIR)
+        return true;
+    if (neighborBlock.IsOpaque())
+        return false;
+
+    BlockDefinition const& neighborDef = BlockDefinition::GetBlockDef(neighborBlock.m_typeIndex);
+    return !neighborDef.m_isOpaque;
+}
+
+void ChunkMesher::AddFace(ChunkMeshSnapshot const& snapshot, int x, int y, int z, BlockDefinition const& blockDef, Direction direction, ChunkMeshData& outMesh)
+{
+    // 面的亮度取相邻方块的光照，没有邻居时按露天算
+    uint8_t neighborLight = LIGHT_MASK_OUTDOOR;
+    Block neighborBlock;
+    if (GetNeighborBlock(snapshot, x, y, z, direction, neighborBlock))
+        neighborLight = neighborBlock.m_lightData;
+
+    const int* faceIndices = Chunk::GetFaceIndices(direction);
+    Vec2 cornerUVs[4];
+    uint8_t atlasTile = GetFaceAtlasTile(blockDef, faceIndices, cornerUVs);
+
+    Vec3 blockLocalPos((float)x, (float)y, (float)z);
+    Vec3 corners[4];
+    for (int i = 0; i < 4; i++)
+    {
+        corners[i] = blockDef.m_verts[faceIndices[i]].m_position + blockLocalPos;
+    }
+    AddQuad(corners, cornerUVs, direction, atlasTile, neighborLight, outMesh);
+}
+
+uint8_t ChunkMesher::GetFaceAtlasTile(BlockDefinition const& blockDef, const int* faceIndices, Vec2 outCornerUVs[4])
+{
+    Vec2 tileMins(1.f, 1.f);
+    Vec2 tileMaxs(0.f, 0.f);
+    for (int i = 0; i < 4; i++)
+    {
+        Vec2 const& uv = blockDef.m_verts[faceIndices[i]].m_uvTexCoords;
+        tileMins = Vec2(fminf(tileMins.x, uv.x), fminf(tileMins.y, uv.y));
+        tileMaxs = Vec2(fmaxf(tileMaxs.x, uv.x), fmaxf(tileMaxs.y, uv.y));
+    }
+    Vec2 tileSize = tileMaxs - tileMins;
+
+    // 每个角在格子里的位置（0 或 1），shader 用它和格子编号还原图集 uv
+    for (int i = 0; i < 4; i++)
+    {
+        Vec2 const& uv = blockDef.m_verts[faceIndices[i]].m_uvTexCoords;
+        outCornerUVs[i] = Vec2(tileSize.x > 0.f ? roundf((uv.x - tileMins.x) / tileSize.x) : 0.f,
+                               tileSize.y > 0.f ? roundf((uv.y - tileMins.y) / tileSize.y) : 0.f);
+    }
+
+    int tileX = (int)floorf(tileMins.x * BLOCK_ATLAS_GRID_X + 0.5f);
+    int tileY = (int)floorf(tileMins.y * BLOCK_ATLAS_GRID_Y + 0.5f);
+    return (uint8_t)(tileX + tileY * BLOCK_ATLAS_GRID_X);
+}
+
+void ChunkMesher::AddQuad(Vec3 const corners[4], Vec2 const uvs[4], Direction direction, uint8_t atlasTile, uint8_t light, ChunkMeshData& outMesh)
+{
+    // 光照存成 0~255 的 unorm，shader 里直接就是 0~1 的影响系数
+    Rgba8 packed(
+        (unsigned char)(((light >> 4) & 0x0F) * 17),
+        (unsigned char)((light & 0x0F) * 17),
+        (unsigned char)direction,
+        atlasTile
+    );
+    for (int i = 0; i < 4; i++)
+    {
+        outMesh.m_vertices.push_back(ChunkVertex(corners[i], packed, uvs[i]));
+    }
+}
+
+// 面的合并键：0 表示这里没有面；否则 = 有效位 | 相邻方块光照 << 8 | 方块类型
+static constexpr uint32_t GREEDY_FACE_VALID = 1u << 31;
+
+uint32_t ChunkMesher::GetGreedyFaceKey(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction)
+{
+    Block const& block = snapshot.m_blocks[ChunkMeshSnapshot::GetIndex(x, y, z)];
+    if (block.m_typeIndex == BLOCK_TYPE_AIR)
+        return 0;
+    if (!BlockDefinition::GetBlockDef(block.m_typeIndex).m_isVisible)
+        return 0;
+    if (!ShouldRenderFace(snapshot, x, y, z, direction))
+        return 0;
+
+    uint8_t neighborLight = LIGHT_MASK_OUTDOOR;
+    Block neighborBlock;
+    if (GetNeighborBlock(snapshot, x, y, z, direction, neighborBlock))
+        neighborLight = neighborBlock.m_lightData;
+
+    return GREEDY_FACE_VALID | ((uint32_t)neighborLight << 8) | (uint32_t)block.m_typeIndex;
+}
+
+void ChunkMesher::BuildGreedyMesh(ChunkMeshSnapshot const& snapshot, int zBegin, int zEnd, ChunkMeshData& outMesh)
+{
+    // 只在 [zBegin, zEnd) 这一段里合并，竖直方向的面不跨 section
+    const int mins[3] = { 0, 0, zBegin };
+    const int dims[3] = { CHUNK_SIZE_X, CHUNK_SIZE_Y, zEnd - zBegin };
+    static_assert(CHUNK_SECTION_SIZE_Z <= CHUNK_SIZE_X && CHUNK_SECTION_SIZE_Z <= CHUNK_SIZE_Y, "greedy slice mask is sized for one section");
+    uint32_t mask[CHUNK_SIZE_X * CHUNK_SIZE_Y];
+
+    for (int dir = 0; dir < NUM_DIRECTIONS; dir++)
+    {
+        Direction direction = (Direction)dir;
+
+        // 法线轴 n 上逐层切片，u / v 是切片内的两个轴
+        int nAxis = 2;
+        int uAxis = 0;
+        int vAxis = 1;
+        if (direction == DIRECTION_EAST || direction == DIRECTION_WEST)
+        {
+            nAxis = 0; uAxis = 1; vAxis = 2;
+        }
+        else if (direction == DIRECTION_NORTH || direction == DIRECTION_SOUTH)
+        {
+            nAxis = 1; uAxis = 0; vAxis = 2;
+        }
+        const int sizeU = dims[uAxis];
+        const int sizeV = dims[vAxis];
+
+        int coords[3];
+        for (int n = 0; n < dims[nAxis]; ++n)
+        {
+            coords[nAxis] = mins[nAxis] + n;
+            for (int v = 0; v < sizeV; ++v)
+            {
+                coords[vAxis] = mins[vAxis] + v;
+                for (int u = 0; u < sizeU; ++u)
+                {
+                    coords[uAxis] = mins[uAxis] + u;
+                    mask[u + v * sizeU] = GetGreedyFaceKey(snapshot, coords[0], coords[1], coords[2], direction);
+                }
+            }
+
+            for (int v = 0; v < sizeV; ++v)
+            {
+                for (int u = 0; u < sizeU; )
+                {
+                    uint32_t key = mask[u + v * sizeU];
+                    if (key == 0)
+                    {
+                        u++;
+                        continue;
+                    }
+
+                    // 先沿 u 尽量延长，再整行整行地沿 v 延长
+                    int width = 1;
+                    while (u + width < sizeU && mask[u + width + v * sizeU] == key)
+                    {
+                        width++;
+                    }
+                    int height = 1;
+                    bool canGrow = true;
+                    while (canGrow && v + height < sizeV)
+                    {
+                        for (int k = 0; k < width; ++k)
+                        {
+                            if (mask[u + k + (v + height) * sizeU] != key)
+                            {
+                                canGrow = false;
+                                break;
+                            }
+                        }
+                        if (canGrow)
+                            height++;
+                    }
+
+                    coords[uAxis] = mins[uAxis] + u;
+                    coords[vAxis] = mins[vAxis] + v;
+                    AddGreedyQuad(coords, uAxis, vAxis, width, height, key, direction, outMesh);
+
+                    for (int dv = 0; dv < height; ++dv)
+                    {
+                        for (int du = 0; du < width; ++du)
+                        {
+                            mask[u + du + (v + dv) * sizeU] = 0;
+                        }
+                    }
+                    u += width;
+                }
+            }
+        }
+    }
+}
+
+static float GetVec3Axis(Vec3 const& vec, int axis)
+{
+    return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+}
+
+void ChunkMesher::AddGreedyQuad(int const baseCoords[3], int uAxis, int vAxis, int width, int height, uint32_t faceKey, Direction direction, ChunkMeshData& outMesh)
+{
+    uint8_t typeIndex = (uint8_t)(faceKey & 0xFF);
+    uint8_t neighborLight = (uint8_t)((faceKey >> 8) & 0xFF);
+    BlockDefinition const& blockDef = BlockDefinition::GetBlockDef(typeIndex);
+
+    const int* faceIndices = Chunk::GetFaceIndices(direction);
+    Vec2 cornerUVs[4];
+    uint8_t atlasTile = GetFaceAtlasTile(blockDef, faceIndices, cornerUVs);
+
+    float extents[3] = { 1.f, 1.f, 1.f };
+    extents[uAxis] = (float)width;
+    extents[vAxis] = (float)height;
+
+    // AddVertsForIndexQuad3D 的顶点顺序：0→1 是纹理 u 方向，1→2 是纹理 v 方向
+    Vec3 const& p0 = blockDef.m_verts[faceIndices[0]].m_position;
+    Vec3 const& p1 = blockDef.m_verts[faceIndices[1]].m_position;
+    Vec3 const& p2 = blockDef.m_verts[faceIndices[2]].m_position;
+    float repeatU = 1.f;
+    float repeatV = 1.f;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (fabsf(GetVec3Axis(p0, axis) - GetVec3Axis(p1, axis)) > 0.5f)
+            repeatU = extents[axis];
+        if (fabsf(GetVec3Axis(p1, axis) - GetVec3Axis(p2, axis)) > 0.5f)
+            repeatV = extents[axis];
+    }
+
+    Vec3 baseLocalPos((float)baseCoords[0], (float)baseCoords[1], (float)baseCoords[2]);
+    Vec3 corners[4];
+    Vec2 uvs[4];
+    for (int i = 0; i < 4; i++)
+    {
+        Vec3 const& unitPos = blockDef.m_verts[faceIndices[i]].m_position;
+        corners[i] = Vec3(unitPos.x * extents[0], unitPos.y * extents[1], unitPos.z * extents[2]) + baseLocalPos;
+        // uv 以方块为单位重复，shader 里 frac 后落回同一个图集格子
+        uvs[i] = Vec2(cornerUVs[i].x * repeatU, cornerUVs[i].y * repeatV);
+    }
+    AddQuad(corners, uvs, direction, atlasTile, neighborLight, outMesh);
+}
@@ -0,0 +1,102 @@
+﻿#pragma once
+#include <mutex>
+#include <vector>
+
+#include "Block.h"
+#include "Gamecommon.hpp"
+#include "Engine/Core/Vertex_PCU.hpp"
+#include "Engine/Math/IntVec2.hpp"
+
+class Chunk;
+
+// 快照比 chunk 在 x/y 方向各多一圈，存四个水平邻居贴边的那一列方块
+constexpr int MESH_SNAPSHOT_SIZE_X = CHUNK_SIZE_X + 2;
+constexpr int MESH_SNAPSHOT_SIZE_Y = CHUNK_SIZE_Y + 2;
+constexpr int MESH_SNAPSHOT_LAYER = MESH_SNAPSHOT_SIZE_X * MESH_SNAPSHOT_SIZE_Y;
+constexpr int MESH_SNAPSHOT_TOTAL_BLOCKS = MESH_SNAPSHOT_LAYER * CHUNK_SIZE_Z;
+
+// 主线程拷贝出来的数据，worker 建网格/传播光照时不再碰 Chunk 本身
+struct ChunkMeshSnapshot
+{
+    IntVec2 m_chunkCoords;
+    uint8_t m_neighborMask = 0;   // 1 << Direction：拷贝时该侧邻居存在
+    uint8_t m_emptySectionMask = 0;   // 1 << section：整段都是同一种不可见方块（空气），建网格时整段跳过
+    uint8_t m_copiedSectionMask = 0;  // 1 << section：这次拷过的段，只重建部分 section 时其余段不拷
+    Block m_blocks[MESH_SNAPSHOT_TOTAL_BLOCKS];
+
+    // 只要重建 sectionMask 里的段；上下相邻的段也一起拷，段边界上的面剔除和光照要用
+    void CopyFrom(Chunk const* chunk, uint8_t sectionMask = CHUNK_ALL_SECTIONS_MASK);
+
+    // localX / localY 可以是 -1 或 CHUNK_SIZE，表示邻居 chunk 的边界方块
+    static inline int GetIndex(int localX, int localY, int localZ)
+    {
+        return (localX + 1) + (localY + 1) * MESH_SNAPSHOT_SIZE_X + localZ * MESH_SNAPSHOT_LAYER;
+    }
+};
+
+enum class ChunkMeshMode : uint8_t
+{
+    STANDARD,  // 每个露出的方块面一个 quad
+    GREEDY     // 同一切片上类型和光照相同的相邻面合并成大矩形
+};
+
+// 紧凑的 chunk 顶点：沿用引擎的 Vertex_PCU 布局（24 字节），字段换了含义
+//   POSITION  chunk 内局部坐标，chunk 原点由 model 矩阵给
+//   COLOR     r = 室外光，g = 室内光（0~15 * 17），b = 面朝向 Direction，a = 图集格子编号
+//   TEXCOORD  以方块为单位的 uv（合并面会大于 1），WorldShader 里 frac 后映射进图集格子
+// 切线空间由面朝向决定，不再逐顶点存；索引是固定的 quad 模式，用 World 共享的索引缓冲
+typedef Vertex_PCU ChunkVertex;
+constexpr int CHUNK_VERTS_PER_QUAD = 4;
+constexpr int CHUNK_INDICES_PER_QUAD = 6;
+
+struct ChunkMeshData
+{
+    std::vector<ChunkVertex> m_vertices;  // 每 4 个一个 quad，按 section 从下往上排
+    uint8_t m_sectionMask = 0;            // 这次重建了哪些 section，其余 section 的网格保持原样
+    uint32_t m_sectionVertexCounts[CHUNK_NUM_SECTIONS] = {};   // 重建的 section 各占 m_vertices 里连续的一段
+};
+
+// 网格构建的临时缓冲池：快照和顶点数组用完归还，vector 保留容量，下一次构建不用重新分配
+// 快照在主线程借、worker 上还；顶点数组在 worker 上借、主线程上传后还，所以池子加锁共享
+// 生成/加载 chunk 时用的连续方块缓冲（Chunk::BeginBuild）也放在这里，在 worker 上借还
+class ChunkMeshScratchPool
+{
+public:
+    static ChunkMeshSnapshot* AcquireSnapshot();
+    static void ReleaseSnapshot(ChunkMeshSnapshot* snapshot);
+    static ChunkMeshData* AcquireMeshData();
+    static void ReleaseMeshData(ChunkMeshData* meshData);
+    static Block* AcquireBlockBuffer();    // CHUNK_TOTAL_BLOCKS 个方块，内容未初始化
+    static void ReleaseBlockBuffer(Block* blocks);
+
+    static size_t GetPooledBytes();
+    static void Clear();
+
+private:
+    static constexpr int MAX_POOLED_ITEMS = MAX_MESH_JOBS_IN_FLIGHT + MAX_LIGHT_JOBS_IN_FLIGHT + 2;
+
+    static std::mutex s_mutex;
+    static std::vector<ChunkMeshSnapshot*> s_freeSnapshots;
+    static std::vector<ChunkMeshData*> s_freeMeshData;
+    static std::vector<Block*> s_freeBlockBuffers;
+};
+
+class ChunkMesher
+{
+public:
+    // 只重建 sectionMask 里的 section；贪心合并不跨 section，这样每段的网格可以单独替换
+    static void BuildMesh(ChunkMeshSnapshot const& snapshot, ChunkMeshData& outMesh, ChunkMeshMode mode = ChunkMeshMode::STANDARD,
+                          uint8_t sectionMask = CHUNK_ALL_SECTIONS_MASK);
+
+private:
+    static void BuildStandardMesh(ChunkMeshSnapshot const& snapshot, int zBegin, int zEnd, ChunkMeshData& outMesh);
+    static void BuildGreedyMesh(ChunkMeshSnapshot const& snapshot, int zBegin, int zEnd, ChunkMeshData& outMesh);
+    static uint32_t GetGreedyFaceKey(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction);
+    static void AddGreedyQuad(int const baseCoords[3], int uAxis, int vAxis, int width, int height, uint32_t faceKey, Direction direction, ChunkMeshData& outMesh);
+    static uint8_t GetFaceAtlasTile(BlockDefinition const& blockDef, const int* faceIndices, Vec2 outCornerUVs[4]);
+    static void AddQuad(Vec3 const corners[4], Vec2 const uvs[4], Direction direction, uint8_t atlasTile, uint8_t light, ChunkMeshData& outMesh);
+
+    static bool ShouldRenderFace(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction);
+    static void AddFace(ChunkMeshSnapshot const& snapshot, int x, int y, int z, BlockDefinition const& blockDef, Direction direction, ChunkMeshData& outMesh);
+    static bool GetNeighborBlock(ChunkMeshSnapshot const& snapshot, int x, int y, int z, Direction direction, Block& outBlock);
+};
@@ -0,0 +1,54 @@
+﻿#include "ChunkPool.h"
+
+#include "Chunk.h"
+
+ChunkPool::ChunkPool(World* owner)
+    : m_owner(owner)
+{
+    m_freeChunks.reserve(MAX_POOLED_CHUNKS);
+}
+
+ChunkPool::~ChunkPool()
+{
+    Clear();
+}
+
+Chunk* ChunkPool::Acquire(IntVec2 const& chunkCoords)
+{
+    if (m_freeChunks.empty())
+    {
+        m_numMisses++;
+        return new Chunk(m_owner, chunkCoords);
+    }
+
+    m_numHits++;
+    Chunk* chunk = m_freeChunks.back();
+    m_freeChunks.pop_back();
+    chunk->ResetForReuse(chunkCoords);
+    return chunk;
+}
+
+void ChunkPool::Release(Chunk* chunk)
+{
+    if (!chunk)
+        return;
+
+    if ((int)m_freeChunks.size() >= MAX_POOLED_CHUNKS)
+    {
+        delete chunk;
+        return;
+    }
+    // GPU 缓冲和方块数组这时就释放，池里的 chunk 只剩对象本身和序列化器的缓冲
+    chunk->ReleaseRenderResources();
+    chunk->ReleaseSectionArrays();
+    m_freeChunks.push_back(chunk);
+}
+
+void ChunkPool::Clear()
+{
+    for (Chunk* chunk : m_freeChunks)
+    {
+        delete chunk;
+    }
+    m_freeChunks.clear();
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Math/IntVec2.hpp"
+
+class Chunk;
+class World;
+
+constexpr int MAX_POOLED_CHUNKS = 128;  // 够快速飞行时一进一出的周转
+
+// 停用的 Chunk 不 delete，重置后留给下一次激活：对象本身、序列化器和它的读写缓冲跟着复用。
+// 方块数组不跟着 chunk 留在池里：进池时还给 ChunkSection 的数组池，由下一个生成/加载的 chunk 直接拿去用。
+// 只在主线程 Acquire/Release（提交任务、处理完成任务、停用都在主线程）。
+class ChunkPool
+{
+public:
+    explicit ChunkPool(World* owner);
+    ~ChunkPool();
+
+    Chunk* Acquire(IntVec2 const& chunkCoords);
+    void Release(Chunk* chunk);
+    void Clear();
+
+    int GetNumFreeChunks() const { return (int)m_freeChunks.size(); }
+    uint64_t GetNumHits() const { return m_numHits; }
+    uint64_t GetNumMisses() const { return m_numMisses; }
+    void ResetCounters() { m_numHits = 0; m_numMisses = 0; }
+
+private:
+    World* m_owner = nullptr;
+    std::vector<Chunk*> m_freeChunks;
+    uint64_t m_numHits = 0;     // 从池里拿到
+    uint64_t m_numMisses = 0;   // 池空，只能 new
+};
@@ -0,0 +1,124 @@
+﻿#include "ChunkSection.h"
+
+#include <algorithm>
+#include <cstring>
+
+std::mutex ChunkSection::s_arrayPoolMutex;
+std::vector<Block*> ChunkSection::s_freeArrays;
+
+ChunkSection::~ChunkSection()
+{
+    ReleaseArray(m_blocks);
+    m_blocks = nullptr;
+}
+
+Block& ChunkSection::GetMutableBlock(int sectionIndex)
+{
+    if (!m_blocks)
+    {
+        m_blocks = AcquireArray();
+        std::fill(m_blocks, m_blocks + CHUNK_BLOCKS_PER_SECTION, m_uniformBlock);
+    }
+    return m_blocks[sectionIndex];
+}
+
+void ChunkSection::SetUniform(Block const& block)
+{
+    ReleaseArray(m_blocks);
+    m_blocks = nullptr;
+    m_uniformBlock = block;
+}
+
+void ChunkSection::CopyFrom(Block const* blocks)
+{
+    if (AreAllSame(blocks, blocks[0]))
+    {
+        SetUniform(blocks[0]);
+        return;
+    }
+    if (!m_blocks)
+    {
+        m_blocks = AcquireArray();
+    }
+    memcpy(m_blocks, blocks, CHUNK_BLOCKS_PER_SECTION * sizeof(Block));
+}
+
+void ChunkSection::CopyTo(Block* outBlocks) const
+{
+    if (m_blocks)
+    {
+        memcpy(outBlocks, m_blocks, CHUNK_BLOCKS_PER_SECTION * sizeof(Block));
+    }
+    else
+    {
+        std::fill(outBlocks, outBlocks + CHUNK_BLOCKS_PER_SECTION, m_uniformBlock);
+    }
+}
+
+bool ChunkSection::TryCompact()
+{
+    if (!m_blocks || !AreAllSame(m_blocks, m_blocks[0]))
+        return false;
+    SetUniform(m_blocks[0]);
+    return true;
+}
+
+size_t ChunkSection::GetPooledArrayBytes()
+{
+    std::lock_guard<std::mutex> lock(s_arrayPoolMutex);
+    return s_freeArrays.size() * CHUNK_BLOCKS_PER_SECTION * sizeof(Block);
+}
+
+void ChunkSection::ClearArrayPool()
+{
+    std::lock_guard<std::mutex> lock(s_arrayPoolMutex);
+    for (Block* blocks : s_freeArrays)
+    {
+        delete[] blocks;
+    }
+    s_freeArrays.clear();
+}
+
+Block* ChunkSection::AcquireArray()
+{
+    {
+        std::lock_guard<std::mutex> lock(s_arrayPoolMutex);
+        if (!s_freeArrays.empty())
+        {
+            Block* blocks = s_freeArrays.back();
+            s_freeArrays.pop_back();
+            return blocks;
+        }
+    }
+    return new Block[CHUNK_BLOCKS_PER_SECTION];
+}
+
+void ChunkSection::ReleaseArray(Block* blocks)
+{
+    if (!blocks)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(s_arrayPoolMutex);
+        if ((int)s_freeArrays.size() < MAX_POOLED_ARRAYS)
+        {
+            s_freeArrays.push_back(blocks);
+            return;
+        }
+    }
+    delete[] blocks;
+}
+
+bool ChunkSection::AreAllSame(Block const* blocks, Block const& value)
+{
+    // 3 字节整体比较，天空/光照不同的方块不能合并
+    for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+    {
+        if (blocks[i].m_typeIndex != value.m_typeIndex ||
+            blocks[i].m_lightData != value.m_lightData ||
+            blocks[i].m_flags != value.m_flags)
+        {
+            return false;
+        }
+    }
+    return true;
+}
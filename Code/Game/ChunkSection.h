@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "Block.h"
+#include "Gamecommon.hpp"
+
+// chunk 沿 z 切成 16 格高的一段。整段 4096 个方块完全相同（高空的空气、深处的石头）时只存一个方块，
+// 不分配数组；有方块要改成不一样的值时才展开。数组在所有 section 之间共用一个池：收回时还到池里，
+// 展开/CopyFrom 先从池里拿，chunk 停用再激活不用每段重新 new 一块。池在 worker 和主线程之间共享，加锁。
+class ChunkSection
+{
+public:
+    ChunkSection() = default;
+    ~ChunkSection();
+    ChunkSection(ChunkSection const&) = delete;
+    ChunkSection& operator=(ChunkSection const&) = delete;
+
+    inline bool IsUniform() const { return m_blocks == nullptr; }
+    inline Block const& GetUniformBlock() const { return m_uniformBlock; }
+    inline Block const* GetBlocks() const { return m_blocks; }   // 整段相同时为 nullptr
+
+    // sectionIndex = 块在段内的下标（chunk 下标的低 12 位）
+    inline Block const& GetBlock(int sectionIndex) const
+    {
+        return m_blocks ? m_blocks[sectionIndex] : m_uniformBlock;
+    }
+    Block& GetMutableBlock(int sectionIndex);   // 整段相同时先展开
+
+    void SetUniform(Block const& block);        // 释放数组，整段变成同一个方块
+    void CopyFrom(Block const* blocks);         // 从连续的 4096 个方块打包，全相同就不分配
+    void CopyTo(Block* outBlocks) const;
+    bool TryCompact();                          // 展开后又变回全相同时收回数组
+
+    inline size_t GetAllocatedBytes() const { return m_blocks ? CHUNK_BLOCKS_PER_SECTION * sizeof(Block) : 0; }
+
+    static size_t GetPooledArrayBytes();
+    static void ClearArrayPool();
+
+private:
+    static bool AreAllSame(Block const* blocks, Block const& value);
+    static Block* AcquireArray();               // CHUNK_BLOCKS_PER_SECTION 个方块，内容未初始化
+    static void ReleaseArray(Block* blocks);
+
+private:
+    static constexpr int MAX_POOLED_ARRAYS = 256;   // ~3 MB，够一批停用的 chunk 交回来的数组周转
+
+    static std::mutex s_arrayPoolMutex;
+    static std::vector<Block*> s_freeArrays;
+
+    Block* m_blocks = nullptr;
+    Block m_uniformBlock;
+};
@@ -4,58 +4,182 @@
 #include "Gamecommon.hpp"
 #include "Engine/Save/RLECompression.h"
 
+namespace
+{
+    void AppendBytes(std::vector<uint8_t>& buffer, void const* data, size_t numBytes)
+    {
+        size_t pos = buffer.size();
+        buffer.resize(pos + numBytes);
+        memcpy(buffer.data() + pos, data, numBytes);
+    }
+
+    // 能表示 paletteSize 个下标所需的位数；只有一种方块时为 0，整段不写数据
+    int GetBitsPerIndex(int paletteSize)
+    {
+        int bits = 0;
+        while ((1 << bits) < paletteSize)
+            bits++;
+        return bits;
+    }
+}
+
 ChunkSerializer::ChunkSerializer(Chunk* myChunk)
     : m_chunk(myChunk)
 {
-    // 分配足够空间存储所有 Block 数据 (3 bytes each)
-    m_blockData = new uint8_t[CHUNK_TOTAL_BLOCKS * sizeof(Block)];
-    
-    // 复制 Block 数据
-    memcpy(m_blockData, myChunk->m_blocks, CHUNK_TOTAL_BLOCKS * sizeof(Block));
 }
 
 ChunkSerializer::~ChunkSerializer()
 {
-    // 释放内存
-    if (m_blockData)
-    {
-        delete[] m_blockData;
-        m_blockData = nullptr;
-    }
 }
 
 void ChunkSerializer::SaveToBinary(std::vector<uint8_t>& buffer) const
 {
-    if (!m_chunk || !m_chunk->m_blocks)
+    if (!m_chunk)
         return;
 
+    if (m_saveVersion == CHUNK_FILE_VERSION_RLE)
+    {
+        // v1 是整块数组的 RLE，先铺成连续的一份
+        Block* blocks = ChunkMeshScratchPool::AcquireBlockBuffer();
+        m_chunk->CopyBlocksTo(blocks);
+        WriteVersion1(blocks, buffer);
+        ChunkMeshScratchPool::ReleaseBlockBuffer(blocks);
+    }
+    else
+    {
+        WriteVersion2(m_chunk->GetSections(), buffer, m_saveLight, &m_chunk->m_lightStamp);
+    }
+}
+
+bool ChunkSerializer::LoadFromBinary(const std::vector<uint8_t>& buffer, size_t& offset)
+{
+    // 直接解码进 chunk 的构建缓冲（调用方负责 BeginBuild/EndBuild）；失败时调用方会重新生成覆盖
+    return ReadBlocks(buffer, offset, m_chunk->m_buildBlocks, &m_chunk->m_lightStamp);
+}
+
+std::string ChunkSerializer::GetSaveIdentifier() const
+{
+    return "GCHK";
+}
+
+void ChunkSerializer::WriteVersion1(Block const* blocks, std::vector<uint8_t>& buffer)
+{
     // 准备要压缩的数据（所有 Block 的原始字节）
     size_t totalBytes = CHUNK_TOTAL_BLOCKS * sizeof(Block);
-    const uint8_t* blockBytes = reinterpret_cast<const uint8_t*>(m_chunk->m_blocks);
+    const uint8_t* blockBytes = reinterpret_cast<const uint8_t*>(blocks);
 
     // 先做 RLE 压缩
     std::vector<uint8_t> compressed = RLECompression::CompressBytes(blockBytes, totalBytes);
     uint32_t compressedSize = static_cast<uint32_t>(compressed.size());
 
     // 1. 写入 header（结构体格式不变）
-    ChunkFileHeader header(CHUNK_BITS_X, CHUNK_BITS_Y, CHUNK_BITS_Z);
-    size_t headerPos = buffer.size();
-    buffer.resize(headerPos + sizeof(ChunkFileHeader));
-    memcpy(buffer.data() + headerPos, &header, sizeof(ChunkFileHeader));
+    ChunkFileHeader header(CHUNK_BITS_X, CHUNK_BITS_Y, CHUNK_BITS_Z, CHUNK_FILE_VERSION_RLE);
+    AppendBytes(buffer, &header, sizeof(ChunkFileHeader));
 
     // 2. 紧接着写入压缩数据长度 compressedSize（uint32_t）
-    size_t sizePos = buffer.size();
-    buffer.resize(sizePos + sizeof(uint32_t));
-    memcpy(buffer.data() + sizePos, &compressedSize, sizeof(uint32_t));
+    AppendBytes(buffer, &compressedSize, sizeof(uint32_t));
 
     // 3. 最后写入压缩后的数据本体
-    size_t compressedPos = buffer.size();
-    buffer.resize(compressedPos + compressed.size());
-    memcpy(buffer.data() + compressedPos, compressed.data(), compressed.size());
+    AppendBytes(buffer, compressed.data(), compressed.size());
 }
 
-bool ChunkSerializer::LoadFromBinary(const std::vector<uint8_t>& buffer, size_t& offset)
+void ChunkSerializer::WriteVersion2(ChunkSection const* sections, std::vector<uint8_t>& buffer, bool includeLight, ChunkLightStamp const* lightStamp)
 {
+    ChunkFileHeader header(CHUNK_BITS_X, CHUNK_BITS_Y, CHUNK_BITS_Z, CHUNK_FILE_VERSION_PALETTE);
+    AppendBytes(buffer, &header, sizeof(ChunkFileHeader));
+
+    bool writeLightStamp = includeLight && lightStamp && lightStamp->m_isValid;
+    uint8_t payloadFlags = includeLight ? CHUNK_PAYLOAD_HAS_LIGHT : 0;
+    if (writeLightStamp)
+        payloadFlags |= CHUNK_PAYLOAD_LIGHT_VALID;
+    buffer.push_back(payloadFlags);
+
+    // 每个 section: [paletteSize][palette...][bit-packed 下标]
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        // 整段相同的 section 调色板只有一项，不写下标
+        Block const* sectionBlocks = sections[section].GetBlocks();
+        if (!sectionBlocks)
+        {
+            buffer.push_back(1);
+            buffer.push_back(sections[section].GetUniformBlock().m_typeIndex);
+            continue;
+        }
+
+        uint8_t paletteIndexOf[256];
+        memset(paletteIndexOf, 0xFF, sizeof(paletteIndexOf));
+        uint8_t palette[NUM_BLOCK_TYPES];
+        int paletteSize = 0;
+        for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+        {
+            uint8_t type = sectionBlocks[i].m_typeIndex;
+            if (paletteIndexOf[type] == 0xFF)
+            {
+                paletteIndexOf[type] = (uint8_t)paletteSize;
+                palette[paletteSize++] = type;
+            }
+        }
+
+        buffer.push_back((uint8_t)paletteSize);
+        AppendBytes(buffer, palette, paletteSize);
+
+        int bits = GetBitsPerIndex(paletteSize);
+        if (bits == 0)
+            continue;
+
+        size_t dataBytes = ((size_t)CHUNK_BLOCKS_PER_SECTION * bits + 7) / 8;
+        size_t dataPos = buffer.size();
+        buffer.resize(dataPos + dataBytes, 0);
+        uint8_t* packed = buffer.data() + dataPos;
+        for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+        {
+            // bits <= 8，一个下标最多跨两个字节
+            size_t bitPos = (size_t)i * bits;
+            int shift = (int)(bitPos & 7);
+            uint16_t value = (uint16_t)(paletteIndexOf[sectionBlocks[i].m_typeIndex] << shift);
+            packed[bitPos >> 3] |= (uint8_t)(value & 0xFF);
+            if (shift + bits > 8)
+                packed[(bitPos >> 3) + 1] |= (uint8_t)(value >> 8);
+        }
+    }
+
+    if (includeLight)
+    {
+        uint8_t lightData[CHUNK_TOTAL_BLOCKS];
+        for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+        {
+            uint8_t* sectionLight = lightData + section * CHUNK_BLOCKS_PER_SECTION;
+            Block const* sectionBlocks = sections[section].GetBlocks();
+            if (!sectionBlocks)
+            {
+                memset(sectionLight, sections[section].GetUniformBlock().m_lightData, CHUNK_BLOCKS_PER_SECTION);
+                continue;
+            }
+            for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+            {
+                sectionLight[i] = sectionBlocks[i].m_lightData;
+            }
+        }
+        std::vector<uint8_t> compressed = RLECompression::CompressBytes(lightData, CHUNK_TOTAL_BLOCKS);
+        uint32_t compressedSize = static_cast<uint32_t>(compressed.size());
+        AppendBytes(buffer, &compressedSize, sizeof(uint32_t));
+        AppendBytes(buffer, compressed.data(), compressed.size());
+    }
+
+    if (writeLightStamp)
+    {
+        buffer.push_back(lightStamp->m_neighborMask);
+        AppendBytes(buffer, lightStamp->m_borderHashes, sizeof(lightStamp->m_borderHashes));
+    }
+}
+
+bool ChunkSerializer::ReadBlocks(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks, ChunkLightStamp* outLightStamp)
+{
+    // 没有凭据的存档（v1、不带光照或保存时光照没收敛）一律视为光照不可信
+    if (outLightStamp)
+        *outLightStamp = ChunkLightStamp();
+
+
     if (offset + sizeof(ChunkFileHeader) > buffer.size())
     {
         ERROR_RECOVERABLE("Chunk file too small for header");
@@ -73,6 +197,86 @@ bool ChunkSerializer::LoadFromBinary(const std::vector<uint8_t>& buffer, size_t&
 
     offset += sizeof(ChunkFileHeader);
 
+    if (header.version == CHUNK_FILE_VERSION_RLE)
+        return ReadVersion1Payload(buffer, offset, outBlocks);
+    if (header.version == CHUNK_FILE_VERSION_PALETTE)
+        return ReadVersion2Payload(buffer, offset, outBlocks, outLightStamp);
+
+    // delta 只有改动，必须由 Chunk 配合生成器还原
+    ERROR_RECOVERABLE("Delta chunk payload cannot be decoded without the generator");
+    return false;
+}
+
+void ChunkSerializer::WriteDelta(std::map<uint16_t, ChunkBlockEdit> const& edits, ChunkDeltaHeader const& deltaHeader, std::vector<uint8_t>& buffer)
+{
+    ChunkFileHeader header(CHUNK_BITS_X, CHUNK_BITS_Y, CHUNK_BITS_Z, CHUNK_FILE_VERSION_DELTA);
+    AppendBytes(buffer, &header, sizeof(ChunkFileHeader));
+    AppendBytes(buffer, &deltaHeader, sizeof(ChunkDeltaHeader));
+
+    uint16_t numEdits = (uint16_t)edits.size();
+    AppendBytes(buffer, &numEdits, sizeof(uint16_t));
+    for (auto const& [blockIndex, edit] : edits)
+    {
+        AppendBytes(buffer, &blockIndex, sizeof(uint16_t));
+        buffer.push_back(edit.m_currentType);
+    }
+}
+
+bool ChunkSerializer::ReadDelta(const std::vector<uint8_t>& buffer, size_t& offset, ChunkDeltaHeader& outDeltaHeader, std::vector<std::pair<uint16_t, uint8_t>>& outEdits)
+{
+    if (PeekVersion(buffer) != CHUNK_FILE_VERSION_DELTA || offset + sizeof(ChunkFileHeader) + sizeof(ChunkDeltaHeader) + sizeof(uint16_t) > buffer.size())
+    {
+        ERROR_RECOVERABLE("Invalid delta chunk payload");
+        return false;
+    }
+    offset += sizeof(ChunkFileHeader);
+    memcpy(&outDeltaHeader, buffer.data() + offset, sizeof(ChunkDeltaHeader));
+    offset += sizeof(ChunkDeltaHeader);
+
+    uint16_t numEdits = 0;
+    memcpy(&numEdits, buffer.data() + offset, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+
+    const size_t editBytes = sizeof(uint16_t) + sizeof(uint8_t);
+    if (offset + numEdits * editBytes > buffer.size())
+    {
+        ERROR_RECOVERABLE("Delta chunk payload truncated");
+        return false;
+    }
+
+    outEdits.clear();
+    outEdits.reserve(numEdits);
+    for (int i = 0; i < numEdits; ++i)
+    {
+        uint16_t blockIndex = 0;
+        memcpy(&blockIndex, buffer.data() + offset, sizeof(uint16_t));
+        uint8_t type = buffer[offset + sizeof(uint16_t)];
+        offset += editBytes;
+
+        if (blockIndex >= CHUNK_TOTAL_BLOCKS || type >= NUM_BLOCK_TYPES)
+        {
+            ERROR_RECOVERABLE("Delta chunk edit out of range");
+            return false;
+        }
+        outEdits.push_back(std::make_pair(blockIndex, type));
+    }
+    return true;
+}
+
+uint8_t ChunkSerializer::PeekVersion(const std::vector<uint8_t>& buffer)
+{
+    if (buffer.size() < sizeof(ChunkFileHeader))
+        return 0;
+
+    ChunkFileHeader header;
+    memcpy(&header, buffer.data(), sizeof(ChunkFileHeader));
+    if (!header.Validate(CHUNK_BITS_X, CHUNK_BITS_Y, CHUNK_BITS_Z))
+        return 0;
+    return header.version;
+}
+
+bool ChunkSerializer::ReadVersion1Payload(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks)
+{
     // 2. 读取紧跟在 header 后面的 compressedSize（uint32_t）
     if (offset + sizeof(uint32_t) > buffer.size())
     {
@@ -100,18 +304,12 @@ bool ChunkSerializer::LoadFromBinary(const std::vector<uint8_t>& buffer, size_t&
         return false;
     }
 
-    // 4. 确保 m_blockData 已分配
-    if (!m_blockData)
-    {
-        m_blockData = new uint8_t[CHUNK_TOTAL_BLOCKS * sizeof(Block)];
-    }
-
     // 5. 解压缩数据
     size_t totalBytes = CHUNK_TOTAL_BLOCKS * sizeof(Block);
     bool success = RLECompression::DecompressBytes(
         buffer.data() + offset,           // 压缩数据起始地址
         static_cast<size_t>(compressedSize), // 压缩数据字节数
-        m_blockData,                      // 输出缓冲区
+        reinterpret_cast<uint8_t*>(outBlocks), // 输出缓冲区
         totalBytes                        // 期望解压后的字节数
     );
 
@@ -121,15 +319,129 @@ bool ChunkSerializer::LoadFromBinary(const std::vector<uint8_t>& buffer, size_t&
         return false;
     }
 
-    // 6. 复制解压后的数据到 chunk->m_blocks
-    memcpy(m_chunk->m_blocks, m_blockData, totalBytes);
-
     // 7. 前进 offset，跳过刚刚消费掉的压缩数据
     offset += compressedSize;
     return true;
 }
 
-std::string ChunkSerializer::GetSaveIdentifier() const
+bool ChunkSerializer::ReadVersion2Payload(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks, ChunkLightStamp* outLightStamp)
 {
-    return "GCHK";
-}
\ No newline at end of file
+    if (offset + 1 > buffer.size())
+    {
+        ERROR_RECOVERABLE("Chunk file too small for payload flags");
+        return false;
+    }
+    uint8_t payloadFlags = buffer[offset++];
+
+    for (int section = 0; section < CHUNK_NUM_SECTIONS; ++section)
+    {
+        if (offset + 1 > buffer.size())
+        {
+            ERROR_RECOVERABLE("Chunk file truncated in section palette");
+            return false;
+        }
+        int paletteSize = buffer[offset++];
+        if (paletteSize == 0 || paletteSize > NUM_BLOCK_TYPES || offset + paletteSize > buffer.size())
+        {
+            ERROR_RECOVERABLE("Invalid chunk section palette");
+            return false;
+        }
+        uint8_t const* palette = buffer.data() + offset;
+        for (int i = 0; i < paletteSize; ++i)
+        {
+            if (palette[i] >= NUM_BLOCK_TYPES)
+            {
+                ERROR_RECOVERABLE("Unknown block type in chunk palette");
+                return false;
+            }
+        }
+        offset += paletteSize;
+
+        Block* sectionBlocks = outBlocks + section * CHUNK_BLOCKS_PER_SECTION;
+        int bits = GetBitsPerIndex(paletteSize);
+        if (bits == 0)
+        {
+            for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+            {
+                sectionBlocks[i].m_flags = 0;
+                sectionBlocks[i].m_lightData = 0;
+                sectionBlocks[i].SetType(palette[0]);
+            }
+            continue;
+        }
+
+        size_t dataBytes = ((size_t)CHUNK_BLOCKS_PER_SECTION * bits + 7) / 8;
+        if (offset + dataBytes > buffer.size())
+        {
+            ERROR_RECOVERABLE("Chunk file truncated in section data");
+            return false;
+        }
+        uint8_t const* packed = buffer.data() + offset;
+        uint16_t indexMask = (uint16_t)((1 << bits) - 1);
+        for (int i = 0; i < CHUNK_BLOCKS_PER_SECTION; ++i)
+        {
+            size_t bitPos = (size_t)i * bits;
+            int shift = (int)(bitPos & 7);
+            uint16_t word = packed[bitPos >> 3];
+            if (shift + bits > 8)
+                word |= (uint16_t)(packed[(bitPos >> 3) + 1] << 8);
+            int paletteIndex = (word >> shift) & indexMask;
+            if (paletteIndex >= paletteSize)
+            {
+                ERROR_RECOVERABLE("Chunk palette index out of range");
+                return false;
+            }
+            // flags 不存盘，由 BlockDefinition 重新推导
+            sectionBlocks[i].m_flags = 0;
+            sectionBlocks[i].m_lightData = 0;
+            sectionBlocks[i].SetType(palette[paletteIndex]);
+        }
+        offset += dataBytes;
+    }
+
+    if (payloadFlags & CHUNK_PAYLOAD_HAS_LIGHT)
+    {
+        if (offset + sizeof(uint32_t) > buffer.size())
+        {
+            ERROR_RECOVERABLE("Chunk file too small for light size");
+            return false;
+        }
+        uint32_t compressedSize = 0;
+        memcpy(&compressedSize, buffer.data() + offset, sizeof(uint32_t));
+        offset += sizeof(uint32_t);
+        if (compressedSize == 0 || (compressedSize % 2) != 0 || offset + compressedSize > buffer.size())
+        {
+            ERROR_RECOVERABLE("Invalid light RLE data size");
+            return false;
+        }
+
+        uint8_t lightData[CHUNK_TOTAL_BLOCKS];
+        if (!RLECompression::DecompressBytes(buffer.data() + offset, compressedSize, lightData, CHUNK_TOTAL_BLOCKS))
+        {
+            ERROR_RECOVERABLE("Light RLE decompression failed");
+            return false;
+        }
+        for (int i = 0; i < CHUNK_TOTAL_BLOCKS; ++i)
+        {
+            outBlocks[i].m_lightData = lightData[i];
+        }
+        offset += compressedSize;
+
+        if (payloadFlags & CHUNK_PAYLOAD_LIGHT_VALID)
+        {
+            ChunkLightStamp lightStamp;
+            if (offset + 1 + sizeof(lightStamp.m_borderHashes) > buffer.size())
+            {
+                ERROR_RECOVERABLE("Chunk file truncated in light stamp");
+                return false;
+            }
+            lightStamp.m_isValid = true;
+            lightStamp.m_neighborMask = buffer[offset++];
+            memcpy(lightStamp.m_borderHashes, buffer.data() + offset, sizeof(lightStamp.m_borderHashes));
+            offset += sizeof(lightStamp.m_borderHashes);
+            if (outLightStamp)
+                *outLightStamp = lightStamp;
+        }
+    }
+    return true;
+}
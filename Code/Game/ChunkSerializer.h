@@ -1,20 +1,38 @@
 ﻿#pragma once
+#include <map>
+#include <vector>
+
 #include "Engine/Save/ISerializable.h"
 
 class Chunk;
+class ChunkSection;
+class Block;
+
+// v1: RLE(原始 3 字节 Block 数组)
+// v2: 每个 16 格高 section 一个方块调色板 + 位压缩下标；flags 读取时由 BlockDefinition 推导；光照可选，单独 RLE，
+//     光照后面可选跟一个 ChunkLightStamp
+// v3: 只存玩家改动 [ChunkDeltaHeader][count][index, type]...，加载时先重新生成再覆盖；不带光照，
+//     所以可信存档光照（CHUNK_PAYLOAD_LIGHT_VALID）只对 v2 全量存档起作用
+constexpr uint8_t CHUNK_FILE_VERSION_RLE = 1;
+constexpr uint8_t CHUNK_FILE_VERSION_PALETTE = 2;
+constexpr uint8_t CHUNK_FILE_VERSION_DELTA = 3;
+constexpr uint8_t CHUNK_FILE_VERSION = CHUNK_FILE_VERSION_PALETTE;
+
+constexpr uint8_t CHUNK_PAYLOAD_HAS_LIGHT = 0x01;
+constexpr uint8_t CHUNK_PAYLOAD_LIGHT_VALID = 0x02;   // 保存时光照已收敛，光照数据后面跟 ChunkLightStamp
 
 #pragma pack(push, 1)
 struct ChunkFileHeader
 {
     char fourCC[4];      // 'GCHK'
-    uint8_t version;     // 1
+    uint8_t version;     // 1 / 2 / 3
     uint8_t bitsX;       // CHUNK_BITS_X
     uint8_t bitsY;       // CHUNK_BITS_Y
     uint8_t bitsZ;       // CHUNK_BITS_Z
     
     ChunkFileHeader() = default;
-    ChunkFileHeader(uint8_t x, uint8_t y, uint8_t z)
-        : version(1), bitsX(x), bitsY(y), bitsZ(z)
+    ChunkFileHeader(uint8_t x, uint8_t y, uint8_t z, uint8_t fileVersion = CHUNK_FILE_VERSION)
+        : version(fileVersion), bitsX(x), bitsY(y), bitsZ(z)
     {
         fourCC[0] = 'G';
         fourCC[1] = 'C';
@@ -26,12 +44,35 @@ struct ChunkFileHeader
     {
         return fourCC[0] == 'G' && fourCC[1] == 'C' && 
                fourCC[2] == 'H' && fourCC[3] == 'K' &&
-               version == 1 &&
+               version >= CHUNK_FILE_VERSION_RLE && version <= CHUNK_FILE_VERSION_DELTA &&
                bitsX == expectedX && bitsY == expectedY && bitsZ == expectedZ;
     }
 };
+
+// v3 紧跟在 ChunkFileHeader 后面：保存时底图是哪个生成器、哪组参数生成的，对不上就不能把改动套上去
+struct ChunkDeltaHeader
+{
+    uint16_t m_generatorVersion = 0;   // WORLD_GEN_VERSION
+    uint32_t m_generatorHash = 0;      // WorldGenOptions::ComputeGeneratorHash
+};
 #pragma pack(pop)
 
+// 保存时光照已收敛的凭据：当时在场的水平邻居，以及它们朝向本 chunk 那一面的哈希。
+// 加载后只有哈希对不上或当时不在场的面才需要重新对齐
+struct ChunkLightStamp
+{
+    bool m_isValid = false;
+    uint8_t m_neighborMask = 0;        // 1 << Direction
+    uint32_t m_borderHashes[4] = {};   // 按 Direction 下标（EAST/WEST/NORTH/SOUTH）
+};
+
+// 相对生成器输出的单个方块改动
+struct ChunkBlockEdit
+{
+    uint8_t m_generatedType = 0;
+    uint8_t m_currentType = 0;
+};
+
 class ChunkSerializer : public ISerializable
 {
     
@@ -42,7 +83,21 @@ public:
     virtual bool LoadFromBinary(const std::vector<uint8_t>& buffer, size_t& offset) override;
     virtual std::string GetSaveIdentifier() const override;
 
+    static void WriteVersion1(Block const* blocks, std::vector<uint8_t>& buffer);
+    static void WriteVersion2(ChunkSection const* sections, std::vector<uint8_t>& buffer, bool includeLight, ChunkLightStamp const* lightStamp = nullptr);
+    static bool ReadBlocks(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks, ChunkLightStamp* outLightStamp = nullptr);
+
+    static void WriteDelta(std::map<uint16_t, ChunkBlockEdit> const& edits, ChunkDeltaHeader const& deltaHeader, std::vector<uint8_t>& buffer);
+    static bool ReadDelta(const std::vector<uint8_t>& buffer, size_t& offset, ChunkDeltaHeader& outDeltaHeader, std::vector<std::pair<uint16_t, uint8_t>>& outEdits);
+    static uint8_t PeekVersion(const std::vector<uint8_t>& buffer);
+
+private:
+    static bool ReadVersion1Payload(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks);
+    static bool ReadVersion2Payload(const std::vector<uint8_t>& buffer, size_t& offset, Block* outBlocks, ChunkLightStamp* outLightStamp);
+
 public:
     Chunk* m_chunk;
-    uint8_t* m_blockData = nullptr;
+    std::vector<uint8_t> m_ioBuffer;   // Save/Load 复用的读写缓冲，随 chunk 一起进池，容量保留
+    uint8_t m_saveVersion = CHUNK_FILE_VERSION;
+    bool m_saveLight = false;
 };
@@ -58,6 +58,20 @@ Game::Game()
 	g_theEventSystem->SubscribeEventCallBackFunction("OpenSettings", Event_OpenSettings);
 	g_theEventSystem->SubscribeEventCallBackFunction("SaveGame", Event_SaveGame);
 	g_theEventSystem->SubscribeEventCallBackFunction("BackToMainMenu", Event_BackToMainMenu);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkChunkLookup", Event_BenchmarkChunkLookup);
+	g_theEventSystem->SubscribeEventCallBackFunction("ConvertChunkFiles", Event_ConvertChunkFiles);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkChunkFormats", Event_BenchmarkChunkFormats);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkMeshing", Event_BenchmarkMeshing);
+	g_theEventSystem->SubscribeEventCallBackFunction("ChunkMemoryReport", Event_ChunkMemoryReport);
+	g_theEventSystem->SubscribeEventCallBackFunction("LightingStats", Event_LightingStats);
+	g_theEventSystem->SubscribeEventCallBackFunction("VerifyLighting", Event_VerifyLighting);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkLightRemoval", Event_BenchmarkLightRemoval);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkSectionRemesh", Event_BenchmarkSectionRemesh);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkGeneration", Event_BenchmarkGeneration);
+	g_theEventSystem->SubscribeEventCallBackFunction("CompareDensityModes", Event_CompareDensityModes);
+	g_theEventSystem->SubscribeEventCallBackFunction("VerifyBatchedNoise", Event_VerifyBatchedNoise);
+	g_theEventSystem->SubscribeEventCallBackFunction("VerifyDensityBounds", Event_VerifyDensityBounds);
+	g_theEventSystem->SubscribeEventCallBackFunction("BenchmarkCaves", Event_BenchmarkCaves);
 }
 
 Game::~Game()
@@ -83,7 +97,7 @@ void Game::Startup()
 	World* oldWorld = m_currentWorld;
 
 	Texture* blockTex = g_theRenderer->CreateOrGetTextureFromFile("Data/Images/SpriteSheet_Squirrel_32x.png", true);
-	m_spriteSheet = new SpriteSheet(*blockTex, IntVec2(8,8));
+	m_spriteSheet = new SpriteSheet(*blockTex, IntVec2(BLOCK_ATLAS_GRID_X, BLOCK_ATLAS_GRID_Y));
 
 	BlockDefinition::InitializeBlockDefs();
 
@@ -95,6 +109,9 @@ void Game::Startup()
 
 void Game::ForceShutdownCurrentWorld()
 {
+	// 新世界建自己的 RegionStorage 之前，旧世界的存盘任务先写完、存储关掉
+	if (m_currentWorld)
+		m_currentWorld->FinishPendingIO(false);
 }
 
 void Game::Update()
@@ -324,11 +341,17 @@ void Game::ImGuiUpdate()
 
 	if (ImGui::Button("Regenerate", ImVec2(ImGui::GetContentRegionAvail().x, 0)))
 	{
-		g_theApp->WorldRestart();
+		// 先删存档再建新世界：新世界在构造时建存档索引，不能看到旧存档。
+		// 删之前旧世界的存储要关掉，排队的存盘任务不能在删完之后把文件重新建出来
+		if (m_currentWorld)
+			m_currentWorld->FinishPendingIO(true);
 		g_theSaveSystem->ForceDeleteFolder();
 		g_theSaveSystem->ForceCreateDefaultSaveFolder();
+		RegionStorage::DeleteAllRegionFiles();
+		g_theApp->WorldRestart();
 		//return;
 	}
+	// 这个窗口里的参数和开关在建世界时全部锁进存档（WorldGen.dat），改了要 Regenerate 才生效
 	ImGui::Separator(); 
 	ImGui::Spacing();  
 
@@ -339,6 +362,11 @@ void Game::ImGuiUpdate()
         ImGui::Text("Density Noise");
         ImGui::DragFloat("Density Noise Scale", &g_densityNoiseScale, 1.0f, 0.0f, 1000.0f);
         ImGui::DragInt("Density Noise Octaves", &g_densityNoiseOctaves, 1, 1, 16);
+        ImGui::Checkbox("Coarse Density Lattice (4x4x8)", &g_useCoarseDensity);
+        ImGui::Checkbox("Skip Blocks Outside Surface Band", &g_useDensityBounds);
+        ImGui::Checkbox("SIMD Batched Noise", &g_useSimdNoise);
+        ImGui::SameLine();
+        ImGui::Text("(%s)", GetNoiseSimdLevelName(GetSupportedNoiseSimdLevel()));
         
         ImGui::Text("Density Noise Bias");
         ImGui::DragFloat("Terrain Height", &g_terrainHeight, 1.0f, 0.0f, 256.0f);
@@ -418,8 +446,61 @@ void Game::ImGuiUpdate()
         ImGui::Checkbox("Continent Height Offset Enabled", &g_continentHeightOffsetEnabled);
         ImGui::Checkbox("Continent Height Scale Enabled", &g_continentHeightScaleEnabled);
         ImGui::Checkbox("Cave Carving Enabled", &g_caveCarvingEnabled);
+        ImGui::Checkbox("Coarse Cave Noise (4x4x4)", &g_useCoarseCaveNoise);
         ImGui::Checkbox("Block Replacement Enabled", &g_blockReplacementEnabled);
         ImGui::Checkbox("Tree Generation Enabled", &g_treeGenerationEnabled);
+        ImGui::Checkbox("Climate Grid (4-block, cached)", &g_useClimateGrid);
+        ImGui::Unindent();
+    }
+
+    // ========== Rendering Settings ==========
+    if (ImGui::CollapsingHeader("Rendering Settings", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Indent();
+        if (ImGui::Checkbox("Greedy Meshing", &g_useGreedyMeshing) && m_currentWorld)
+        {
+            m_currentWorld->MarkAllChunkMeshesDirty();
+        }
+        if (m_currentWorld)
+        {
+            MeshingStats const& stats = m_currentWorld->GetMeshingStats();
+            ImGui::Text("Mesh builds: %lld for %lld chunks (%.2f per chunk), %lld from edits",
+                (long long)stats.m_numMeshBuilds, (long long)stats.m_numFirstBuilds,
+                stats.m_numFirstBuilds > 0 ? (double)stats.m_numMeshBuilds / (double)stats.m_numFirstBuilds : 0.0,
+                (long long)stats.m_numEditBuilds);
+            ImGui::Text("Returning neighbors: %lld border sections remeshed / %lld kept",
+                (long long)stats.m_numBorderSectionsRemeshed, (long long)stats.m_numBorderSectionsKept);
+        }
+        ImGui::Unindent();
+    }
+
+    // ========== Lighting Settings ==========
+    if (ImGui::CollapsingHeader("Lighting Settings", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Indent();
+        ImGui::DragInt("Budget (us/frame, 0 = unlimited)", &g_lightingBudgetMicroseconds, 50, 0, 20000);
+        ImGui::Checkbox("Parallel Lighting", &g_useParallelLighting);
+        ImGui::Checkbox("Two-Phase Light Updates", &g_useLightRemovalBfs);
+        if (m_currentWorld)
+        {
+            LightingStats const& stats = m_currentWorld->GetLightingStats();
+            ImGui::Text("Last frame: %d blocks in %.0f us", stats.m_lastFrameBlocks, stats.m_lastFrameMicroseconds);
+            ImGui::Text("Queue: %d blocks in %d chunks (peak %d)", stats.m_queueDepth, stats.m_numDirtyChunks, stats.m_peakQueueDepth);
+            ImGui::Text("Light jobs: %d in flight, %lld blocks on workers", stats.m_numLightJobsInFlight, (long long)stats.m_workerBlocks);
+            ImGui::Text("Settle: last %.1f ms, max %.1f ms", stats.m_lastSettleSeconds * 1000.0, stats.m_maxSettleSeconds * 1000.0);
+            ImGui::Text("Edit settle: last %.1f ms, max %.1f ms", stats.m_lastEditSettleSeconds * 1000.0, stats.m_maxEditSettleSeconds * 1000.0);
+            ImGui::Text("Saved light: %d trusted loads, faces %lld skipped / %lld relit",
+                stats.m_numTrustedLightLoads, (long long)stats.m_numBorderFacesSkipped, (long long)stats.m_numBorderFacesRelit);
+        }
+        ImGui::Unindent();
+    }
+
+    // ========== Save Settings ==========
+    if (ImGui::CollapsingHeader("Save Settings", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        ImGui::Indent();
+        ImGui::Checkbox("Save Only Player Edits", &g_saveOnlyPlayerEdits);
+        ImGui::Checkbox("Save Chunk Lighting", &g_saveChunkLighting);
         ImGui::Unindent();
     }
     
@@ -438,6 +519,12 @@ void Game::ImGuiUpdate()
     	ImGui::RadioButton("Smoothed", &g_debugVisualizationMode, 7);
     
     	ImGui::Checkbox("Chunk Bounds", &g_showChunkBounds);
+    	if (m_currentWorld)
+    	{
+    		ChunkPool const& pool = m_currentWorld->GetChunkPool();
+    		ImGui::Text("Chunk Pool: %d free, %llu hits / %llu misses", pool.GetNumFreeChunks(),
+    			(unsigned long long)pool.GetNumHits(), (unsigned long long)pool.GetNumMisses());
+    	}
     
     	ImGui::Unindent();
     }
@@ -684,3 +771,145 @@ bool Event_BackToMainMenu(EventArgs& args)
 	g_theGame->m_gameUIManager->OpenMainMenu();
 	return true;
 }
+
+bool Event_BenchmarkChunkLookup(EventArgs& args)
+{
+	int numPasses = args.GetValue("passes", 200);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkChunkLookup(numPasses);
+	}
+	return true;
+}
+
+bool Event_ConvertChunkFiles(EventArgs& args)
+{
+	std::string folder = args.GetValue("folder", CHUNK_SAVE_FOLDER);
+	bool deleteOld = args.GetValue("delete", false);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->ConvertLegacyChunkFiles(folder, deleteOld);
+	}
+	return true;
+}
+
+bool Event_BenchmarkChunkFormats(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkChunkFormats();
+	}
+	return true;
+}
+
+bool Event_BenchmarkMeshing(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkMeshing();
+	}
+	return true;
+}
+
+bool Event_ChunkMemoryReport(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->ReportChunkMemory();
+	}
+	return true;
+}
+
+bool Event_LightingStats(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->ReportLightingStats();
+	}
+	return true;
+}
+
+bool Event_VerifyLighting(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->VerifyLighting();
+	}
+	return true;
+}
+
+bool Event_BenchmarkLightRemoval(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkLightRemoval();
+	}
+	return true;
+}
+
+bool Event_BenchmarkSectionRemesh(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkSectionRemesh();
+	}
+	return true;
+}
+
+bool Event_BenchmarkGeneration(EventArgs& args)
+{
+	int numChunks = args.GetValue("chunks", 64);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkGeneration(numChunks);
+	}
+	return true;
+}
+
+bool Event_CompareDensityModes(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 2);
+	std::string imagePath = args.GetValue("file", "DensityDiff.ppm");
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->CompareDensityModes(radius, imagePath);
+	}
+	return true;
+}
+
+bool Event_VerifyBatchedNoise(EventArgs& args)
+{
+	UNUSED(args);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->VerifyBatchedNoise();
+	}
+	return true;
+}
+
+bool Event_VerifyDensityBounds(EventArgs& args)
+{
+	int radius = args.GetValue("radius", 2);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->VerifyDensityBounds(radius);
+	}
+	return true;
+}
+
+bool Event_BenchmarkCaves(EventArgs& args)
+{
+	int numChunks = args.GetValue("chunks", 64);
+	if (g_theGame->m_currentWorld)
+	{
+		g_theGame->m_currentWorld->BenchmarkCaves(numChunks);
+	}
+	return true;
+}
@@ -65,6 +65,11 @@ private:
 public:
 	float g_densityNoiseScale = 128.0f;
 	int g_densityNoiseOctaves = 8;
+	bool g_useCoarseDensity = true;          // 密度噪声在 4x4x8 粗格点上采样后三线性插值
+	bool g_useSimdNoise = true;              // 生成器成行算噪声时用 CPU 支持的最高 SIMD 级别
+	bool g_useClimateGrid = true;            // 群系参数在 4 格网格上采样后双线性插值，网格点按区域缓存
+	bool g_useDensityBounds = true;          // 每列按密度上下界跳过地表带以外的格子，直接填石头/空气
+	bool g_useCoarseCaveNoise = true;        // 洞穴 cheese/noodle 噪声在 4x4x4 粗格点上采样后三线性插值
 	float g_terrainHeight = 64.0f;
 	float g_terrainReferenceHeight = 80.0f;
 	float g_biasPerZ = 0.016f;
@@ -102,6 +107,15 @@ public:
 	bool g_blockReplacementEnabled = true;
 	bool g_caveCarvingEnabled = true;
 	bool g_treeGenerationEnabled = true;
+	// Rendering
+	bool g_useGreedyMeshing = false;
+	// Lighting
+	int g_lightingBudgetMicroseconds = 2000;   // 每帧光照预算，<= 0 表示每帧处理完
+	bool g_useParallelLighting = true;
+	bool g_useLightRemovalBfs = true;         // 挖/放方块用两阶段（先变暗再重传播）光照更新
+	// Save
+	bool g_saveChunkLighting = false;
+	bool g_saveOnlyPlayerEdits = true;
 
 	float g_caveGeneratingThreshold = 0.2f;
 	// Debug
@@ -129,6 +143,20 @@ bool Event_ResumeGame(EventArgs& args);
 bool Event_OpenSettings(EventArgs& args);
 bool Event_SaveGame(EventArgs& args);
 bool Event_BackToMainMenu(EventArgs& args);
+bool Event_BenchmarkChunkLookup(EventArgs& args);
+bool Event_ConvertChunkFiles(EventArgs& args);
+bool Event_BenchmarkChunkFormats(EventArgs& args);
+bool Event_BenchmarkMeshing(EventArgs& args);
+bool Event_ChunkMemoryReport(EventArgs& args);
+bool Event_LightingStats(EventArgs& args);
+bool Event_VerifyLighting(EventArgs& args);
+bool Event_BenchmarkLightRemoval(EventArgs& args);
+bool Event_BenchmarkSectionRemesh(EventArgs& args);
+bool Event_BenchmarkGeneration(EventArgs& args);
+bool Event_CompareDensityModes(EventArgs& args);
+bool Event_VerifyBatchedNoise(EventArgs& args);
+bool Event_VerifyDensityBounds(EventArgs& args);
+bool Event_BenchmarkCaves(EventArgs& args);
 
 
 
@@ -50,6 +50,16 @@ constexpr int CHUNK_MASK_Z = CHUNK_MAX_Z << (CHUNK_BITS_X + CHUNK_BITS_Y);
 constexpr int BLOCKS_PER_CHUNK = CHUNK_SIZE_X * CHUNK_SIZE_Y * CHUNK_SIZE_Z;
     
 static constexpr int CHUNK_TOTAL_BLOCKS = 1 << (CHUNK_BITS_X + CHUNK_BITS_Y + CHUNK_BITS_Z);  // 32768
+static constexpr int CHUNK_NUM_COLUMNS = 1 << CHUNK_BITS_XY;  // 256
+
+// 16 格高的 section：z 在 index 的最高位，所以每个 section 是一段连续的 index
+static constexpr int CHUNK_SECTION_BITS_Z = 4;
+static constexpr int CHUNK_SECTION_SIZE_Z = 1 << CHUNK_SECTION_BITS_Z;                  // 16
+static constexpr int CHUNK_NUM_SECTIONS = CHUNK_SIZE_Z / CHUNK_SECTION_SIZE_Z;          // 8
+static constexpr int CHUNK_BLOCKS_PER_SECTION = CHUNK_TOTAL_BLOCKS / CHUNK_NUM_SECTIONS; // 4096
+static constexpr int CHUNK_SECTION_INDEX_BITS = CHUNK_BITS_XY + CHUNK_SECTION_BITS_Z;       // 12：chunk 下标右移这么多位得到 section
+static constexpr int CHUNK_SECTION_INDEX_MASK = CHUNK_BLOCKS_PER_SECTION - 1;
+static constexpr uint8_t CHUNK_ALL_SECTIONS_MASK = (uint8_t)((1 << CHUNK_NUM_SECTIONS) - 1);
 
 constexpr int CHUNK_ACTIVATION_RANGE = 320;
 constexpr int CHUNK_DEACTIVATION_RANGE = CHUNK_ACTIVATION_RANGE + CHUNK_SIZE_X + CHUNK_SIZE_Y;
@@ -59,6 +69,17 @@ constexpr int CHUNK_ACTIVATION_RADIUS_Y = 1 + (CHUNK_ACTIVATION_RANGE / CHUNK_SI
 constexpr int MAX_ACTIVE_CHUNKS = (2 * CHUNK_ACTIVATION_RADIUS_X) * (2 * CHUNK_ACTIVATION_RADIUS_Y);
 
 constexpr int MAX_CONCURRENT_JOBS = 8;
+constexpr int MAX_MESH_JOBS_IN_FLIGHT = 16;
+constexpr int MAX_MESH_JOBS_PER_FRAME = 8;
+constexpr double MESH_MAX_WAIT_FOR_LIGHT_SECONDS = 0.25;  // 新 chunk 第一次建网格前最多等边界光照对齐这么久
+constexpr int MAX_LIGHT_JOBS_IN_FLIGHT = 8;
+constexpr int LIGHT_JOB_MIN_BLOCKS = 256;          // 排队方块少于这个数就留在主线程处理，不值得拷快照
+constexpr int LIGHT_BLOCKS_PER_CHUNK_TURN = 512;  // 轮转处理光照时每个 chunk 一次最多处理的方块数
+constexpr int LIGHT_BLOCKS_PER_BUDGET_CHECK = 64; // 每处理这么多方块看一次时间预算
+constexpr int MAX_SAVE_ATTEMPTS = 3;               // 停用时写 region 失败后最多重试到这么多次，之后把 chunk 留在内存里
+
+constexpr int BLOCK_ATLAS_GRID_X = 8;
+constexpr int BLOCK_ATLAS_GRID_Y = 8;
 
 constexpr uint8_t LIGHT_MASK_OUTDOOR = 0xF0;  
 constexpr uint8_t LIGHT_MASK_INDOOR  = 0x0F;  
@@ -173,5 +194,8 @@ struct WorldConstants
 	float FogFarDistance;
 	float FogMaxAlpha;        // 雾的最大不透明度
 	float Padding3;
+
+	float AtlasGridSize[2];   // 方块图集的格子数，chunk 顶点只存格子编号
+	float Padding4[2];
 };
 static constexpr int k_worldConstantsSlot = 5;
\ No newline at end of file
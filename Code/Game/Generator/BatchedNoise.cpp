@@ -0,0 +1,368 @@
+﻿#include "BatchedNoise.h"
+
+// 存档不记录 SIMD 级别，结果必须和逐点的 Compute3dPerlinNoise 逐位相同：乘加不许合并成 FMA（要在 include 之前，
+// 内联进来的 SmoothStep3 也算在内）。标量那份在 Engine 里，同样按默认的 /fp:precise 编译、不开 /fp:contract
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#include <cmath>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "Engine/Math/MathUtils.hpp"
+#include "ThirdParty/Noise/RawNoise.hpp"
+#include "ThirdParty/Noise/SmoothNoise.hpp"
+
+namespace
+{
+    constexpr float OCTAVE_OFFSET = 0.636764989593174f;                // 和 SmoothNoise 每个八度加的偏移相同，打散各八度的网格
+    constexpr float GRADIENT_COMPONENT = 0.5773502691896257645091f;   // 8 个梯度都指向立方体角，分量是 ±sqrt(3)/3
+    constexpr int NOISE_BATCH_SIZE = 16;                                // 一批的点数，正好是一行 chunk
+    constexpr int NOISE_CELL_CACHE_SIZE = NOISE_BATCH_SIZE + 8;         // 一批点跨的 x 格子超过这么多就逐点算哈希
+    constexpr unsigned int FLOAT_SIGN_BIT = 0x80000000u;
+
+    // 哈希低 3 位选梯度：bit0/bit1/bit2 分别让 x/y/z 分量取负（与 SmoothNoise 的梯度表顺序一致）
+    enum NoiseCorner
+    {
+        BELOW_SW, BELOW_SE, BELOW_NW, BELOW_NE,
+        ABOVE_SW, ABOVE_SE, ABOVE_NW, ABOVE_NE,
+        NUM_NOISE_CORNERS
+    };
+
+    struct PerlinParams
+    {
+        float m_scale;
+        unsigned int m_numOctaves;
+        float m_octavePersistence;
+        float m_octaveScale;
+        bool m_renormalize;
+        unsigned int m_seed;
+    };
+
+    struct alignas(32) NoiseBatchState
+    {
+        float m_posX[NOISE_BATCH_SIZE];
+        float m_cellMinX[NOISE_BATCH_SIZE];
+        float m_total[NOISE_BATCH_SIZE];
+        // 每个角点的梯度下标（0~7）。点积按分量取负：±k*d 与 k*(±d) 逐位相同，所以用符号位异或代替乘法
+        int m_gradients[NUM_NOISE_CORNERS][NOISE_BATCH_SIZE];
+    };
+
+    struct LanesSse41
+    {
+        static constexpr int WIDTH = 4;
+        using Float = __m128;
+        using Int = __m128i;
+
+        static Float Load(float const* p)             { return _mm_load_ps(p); }
+        static void Store(float* p, Float v)          { _mm_store_ps(p, v); }
+        static Float Set1(float v)                    { return _mm_set1_ps(v); }
+        static Float Add(Float a, Float b)            { return _mm_add_ps(a, b); }
+        static Float Sub(Float a, Float b)            { return _mm_sub_ps(a, b); }
+        static Float Mul(Float a, Float b)            { return _mm_mul_ps(a, b); }
+        static Float Floor(Float v)                   { return _mm_floor_ps(v); }
+        static Int LoadInt(int const* p)              { return _mm_load_si128(reinterpret_cast<__m128i const*>(p)); }
+        // 梯度下标的第 BIT 位移到符号位，只留符号位，再和 v 异或
+        template <int BIT>
+        static Float FlipSignByBit(Float v, Int gradients)
+        {
+            Int signBits = _mm_and_si128(_mm_slli_epi32(gradients, 31 - BIT), _mm_set1_epi32((int)FLOAT_SIGN_BIT));
+            return _mm_xor_ps(v, _mm_castsi128_ps(signBits));
+        }
+    };
+
+    struct LanesAvx2
+    {
+        static constexpr int WIDTH = 8;
+        using Float = __m256;
+        using Int = __m256i;
+
+        static Float Load(float const* p)             { return _mm256_load_ps(p); }
+        static void Store(float* p, Float v)          { _mm256_store_ps(p, v); }
+        static Float Set1(float v)                    { return _mm256_set1_ps(v); }
+        static Float Add(Float a, Float b)            { return _mm256_add_ps(a, b); }
+        static Float Sub(Float a, Float b)            { return _mm256_sub_ps(a, b); }
+        static Float Mul(Float a, Float b)            { return _mm256_mul_ps(a, b); }
+        static Float Floor(Float v)                   { return _mm256_floor_ps(v); }
+        static Int LoadInt(int const* p)              { return _mm256_load_si256(reinterpret_cast<__m256i const*>(p)); }
+        template <int BIT>
+        static Float FlipSignByBit(Float v, Int gradients)
+        {
+            Int signBits = _mm256_and_si256(_mm256_slli_epi32(gradients, 31 - BIT), _mm256_set1_epi32((int)FLOAT_SIGN_BIT));
+            return _mm256_xor_ps(v, _mm256_castsi256_ps(signBits));
+        }
+    };
+
+    NoiseSimdLevel DetectNoiseSimdLevel()
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        int info[4] = {};
+        __cpuid(info, 0);
+        const int maxLeaf = info[0];
+        if (maxLeaf < 1)
+            return NoiseSimdLevel::SCALAR;
+
+        __cpuid(info, 1);
+        const bool hasSse41 = (info[2] & (1 << 19)) != 0;
+        const bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+        const bool hasAvx = (info[2] & (1 << 28)) != 0;
+        // 系统还得开了 YMM 状态保存，AVX 寄存器才能用
+        const bool avxEnabledByOs = hasOsxsave && hasAvx && ((_xgetbv(0) & 0x6) == 0x6);
+        bool hasAvx2 = false;
+        if (maxLeaf >= 7 && avxEnabledByOs)
+        {
+            __cpuidex(info, 7, 0);
+            hasAvx2 = (info[1] & (1 << 5)) != 0;
+        }
+        if (hasAvx2)
+            return NoiseSimdLevel::AVX2;
+        if (hasSse41)
+            return NoiseSimdLevel::SSE41;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        if (__builtin_cpu_supports("avx2"))
+            return NoiseSimdLevel::AVX2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return NoiseSimdLevel::SSE41;
+#endif
+        return NoiseSimdLevel::SCALAR;
+    }
+
+    // 当前八度每个点 8 个角点的梯度下标。角点哈希按 x 格子缓存 4 个 (y,z) 组合，东西相邻的格子共用一个面
+    void ComputeCornerGradients(NoiseBatchState& state, int numLanes, int cellMinY, int cellMinZ, unsigned int seed)
+    {
+        int minCellX = (int)state.m_cellMinX[0];
+        int maxCellX = minCellX;
+        for (int lane = 1; lane < numLanes; ++lane)
+        {
+            int cellX = (int)state.m_cellMinX[lane];
+            minCellX = cellX < minCellX ? cellX : minCellX;
+            maxCellX = cellX > maxCellX ? cellX : maxCellX;
+        }
+
+        int cellGradients[NOISE_CELL_CACHE_SIZE][4];
+        const int numCachedCells = maxCellX - minCellX + 2;
+        const bool useCache = numCachedCells <= NOISE_CELL_CACHE_SIZE;
+        if (useCache)
+        {
+            for (int cell = 0; cell < numCachedCells; ++cell)
+            {
+                int cellX = minCellX + cell;
+                cellGradients[cell][0] = (int)(Get3dNoiseUint(cellX, cellMinY, cellMinZ, seed) & 0x7);
+                cellGradients[cell][1] = (int)(Get3dNoiseUint(cellX, cellMinY + 1, cellMinZ, seed) & 0x7);
+                cellGradients[cell][2] = (int)(Get3dNoiseUint(cellX, cellMinY, cellMinZ + 1, seed) & 0x7);
+                cellGradients[cell][3] = (int)(Get3dNoiseUint(cellX, cellMinY + 1, cellMinZ + 1, seed) & 0x7);
+            }
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                const int westCell = (int)state.m_cellMinX[lane] - minCellX;
+                int const* west = cellGradients[westCell];
+                int const* east = cellGradients[westCell + 1];
+                state.m_gradients[BELOW_SW][lane] = west[0];
+                state.m_gradients[BELOW_SE][lane] = east[0];
+                state.m_gradients[BELOW_NW][lane] = west[1];
+                state.m_gradients[BELOW_NE][lane] = east[1];
+                state.m_gradients[ABOVE_SW][lane] = west[2];
+                state.m_gradients[ABOVE_SE][lane] = east[2];
+                state.m_gradients[ABOVE_NW][lane] = west[3];
+                state.m_gradients[ABOVE_NE][lane] = east[3];
+            }
+            return;
+        }
+
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const int westX = (int)state.m_cellMinX[lane];
+            state.m_gradients[BELOW_SW][lane] = (int)(Get3dNoiseUint(westX, cellMinY, cellMinZ, seed) & 0x7);
+            state.m_gradients[BELOW_SE][lane] = (int)(Get3dNoiseUint(westX + 1, cellMinY, cellMinZ, seed) & 0x7);
+            state.m_gradients[BELOW_NW][lane] = (int)(Get3dNoiseUint(westX, cellMinY + 1, cellMinZ, seed) & 0x7);
+            state.m_gradients[BELOW_NE][lane] = (int)(Get3dNoiseUint(westX + 1, cellMinY + 1, cellMinZ, seed) & 0x7);
+            state.m_gradients[ABOVE_SW][lane] = (int)(Get3dNoiseUint(westX, cellMinY, cellMinZ + 1, seed) & 0x7);
+            state.m_gradients[ABOVE_SE][lane] = (int)(Get3dNoiseUint(westX + 1, cellMinY, cellMinZ + 1, seed) & 0x7);
+            state.m_gradients[ABOVE_NW][lane] = (int)(Get3dNoiseUint(westX, cellMinY + 1, cellMinZ + 1, seed) & 0x7);
+            state.m_gradients[ABOVE_NE][lane] = (int)(Get3dNoiseUint(westX + 1, cellMinY + 1, cellMinZ + 1, seed) & 0x7);
+        }
+    }
+
+    // 一批（<= NOISE_BATCH_SIZE）点。运算顺序照抄 Compute3dPerlinNoise，只是 x 方向按 SIMD 宽度并行
+    template <typename Lanes>
+    void ComputePerlinBatch(float const* posX, float posY, float posZ, int count, float* outNoise, PerlinParams const& params)
+    {
+        using Float = typename Lanes::Float;
+
+        NoiseBatchState state;
+        const float invScale = 1.f / params.m_scale;
+        const int numLanes = (count + Lanes::WIDTH - 1) / Lanes::WIDTH * Lanes::WIDTH;
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            // 补齐 SIMD 宽度的空位复制最后一个点，不会多占格子缓存
+            state.m_posX[lane] = posX[lane < count ? lane : count - 1] * invScale;
+            state.m_total[lane] = 0.f;
+        }
+
+        float currentY = posY * invScale;
+        float currentZ = posZ * invScale;
+        float currentAmplitude = 1.f;
+        float totalAmplitude = 0.f;
+        unsigned int seed = params.m_seed;
+
+        const Float gradientComponent = Lanes::Set1(GRADIENT_COMPONENT);
+        const Float one = Lanes::Set1(1.f);
+        const Float two = Lanes::Set1(2.f);
+        const Float three = Lanes::Set1(3.f);
+        const Float octaveGain = Lanes::Set1(1.5f);
+        const Float octaveScale = Lanes::Set1(params.m_octaveScale);
+        const Float octaveOffset = Lanes::Set1(OCTAVE_OFFSET);
+
+        for (unsigned int octaveNum = 0; octaveNum < params.m_numOctaves; ++octaveNum)
+        {
+            for (int lane = 0; lane < numLanes; lane += Lanes::WIDTH)
+            {
+                Lanes::Store(&state.m_cellMinX[lane], Lanes::Floor(Lanes::Load(&state.m_posX[lane])));
+            }
+            const float cellMinY = floorf(currentY);
+            const float cellMinZ = floorf(currentZ);
+            ComputeCornerGradients(state, numLanes, (int)cellMinY, (int)cellMinZ, seed);
+
+            // 一行点的 y、z 相同，这两个方向的位移和权重整行共用
+            const float displacementY = currentY - cellMinY;
+            const float displacementZ = currentZ - cellMinZ;
+            const Float southY = Lanes::Set1(GRADIENT_COMPONENT * displacementY);
+            const Float northY = Lanes::Set1(GRADIENT_COMPONENT * (currentY - (cellMinY + 1.f)));
+            const Float belowZ = Lanes::Set1(GRADIENT_COMPONENT * displacementZ);
+            const Float aboveZ = Lanes::Set1(GRADIENT_COMPONENT * (currentZ - (cellMinZ + 1.f)));
+            const float weightNorthScalar = SmoothStep3(displacementY);
+            const float weightAboveScalar = SmoothStep3(displacementZ);
+            const Float weightNorth = Lanes::Set1(weightNorthScalar);
+            const Float weightSouth = Lanes::Set1(1.f - weightNorthScalar);
+            const Float weightAbove = Lanes::Set1(weightAboveScalar);
+            const Float weightBelow = Lanes::Set1(1.f - weightAboveScalar);
+            const Float amplitude = Lanes::Set1(currentAmplitude);
+
+            for (int lane = 0; lane < numLanes; lane += Lanes::WIDTH)
+            {
+                Float pos = Lanes::Load(&state.m_posX[lane]);
+                Float cellMin = Lanes::Load(&state.m_cellMinX[lane]);
+                Float displacementWestX = Lanes::Sub(pos, cellMin);
+                Float westX = Lanes::Mul(gradientComponent, displacementWestX);
+                Float eastX = Lanes::Mul(gradientComponent, Lanes::Sub(pos, Lanes::Add(cellMin, one)));
+
+                auto dotCorner = [&](int corner, Float x, Float y, Float z)
+                {
+                    typename Lanes::Int gradients = Lanes::LoadInt(&state.m_gradients[corner][lane]);
+                    Float dot = Lanes::Add(Lanes::template FlipSignByBit<0>(x, gradients),
+                                           Lanes::template FlipSignByBit<1>(y, gradients));
+                    return Lanes::Add(dot, Lanes::template FlipSignByBit<2>(z, gradients));
+                };
+                Float dotBelowSW = dotCorner(BELOW_SW, westX, southY, belowZ);
+                Float dotBelowSE = dotCorner(BELOW_SE, eastX, southY, belowZ);
+                Float dotBelowNW = dotCorner(BELOW_NW, westX, northY, belowZ);
+                Float dotBelowNE = dotCorner(BELOW_NE, eastX, northY, belowZ);
+                Float dotAboveSW = dotCorner(ABOVE_SW, westX, southY, aboveZ);
+                Float dotAboveSE = dotCorner(ABOVE_SE, eastX, southY, aboveZ);
+                Float dotAboveNW = dotCorner(ABOVE_NW, westX, northY, aboveZ);
+                Float dotAboveNE = dotCorner(ABOVE_NE, eastX, northY, aboveZ);
+
+                // SmoothStep3(t) = t*t*(3-2t)
+                Float weightEast = Lanes::Mul(Lanes::Mul(displacementWestX, displacementWestX),
+                                              Lanes::Sub(three, Lanes::Mul(two, displacementWestX)));
+                Float weightWest = Lanes::Sub(one, weightEast);
+
+                Float blendBelowSouth = Lanes::Add(Lanes::Mul(weightEast, dotBelowSE), Lanes::Mul(weightWest, dotBelowSW));
+                Float blendBelowNorth = Lanes::Add(Lanes::Mul(weightEast, dotBelowNE), Lanes::Mul(weightWest, dotBelowNW));
+                Float blendAboveSouth = Lanes::Add(Lanes::Mul(weightEast, dotAboveSE), Lanes::Mul(weightWest, dotAboveSW));
+                Float blendAboveNorth = Lanes::Add(Lanes::Mul(weightEast, dotAboveNE), Lanes::Mul(weightWest, dotAboveNW));
+                Float blendBelow = Lanes::Add(Lanes::Mul(weightSouth, blendBelowSouth), Lanes::Mul(weightNorth, blendBelowNorth));
+                Float blendAbove = Lanes::Add(Lanes::Mul(weightSouth, blendAboveSouth), Lanes::Mul(weightNorth, blendAboveNorth));
+                Float blendTotal = Lanes::Add(Lanes::Mul(weightBelow, blendBelow), Lanes::Mul(weightAbove, blendAbove));
+                Float noiseThisOctave = Lanes::Mul(octaveGain, blendTotal);
+
+                Float total = Lanes::Load(&state.m_total[lane]);
+                Lanes::Store(&state.m_total[lane], Lanes::Add(total, Lanes::Mul(noiseThisOctave, amplitude)));
+                Lanes::Store(&state.m_posX[lane], Lanes::Add(Lanes::Mul(pos, octaveScale), octaveOffset));
+            }
+
+            totalAmplitude += currentAmplitude;
+            currentAmplitude *= params.m_octavePersistence;
+            currentY *= params.m_octaveScale;
+            currentZ *= params.m_octaveScale;
+            currentY += OCTAVE_OFFSET;
+            currentZ += OCTAVE_OFFSET;
+            ++seed;
+        }
+
+        for (int lane = 0; lane < count; ++lane)
+        {
+            float totalNoise = state.m_total[lane];
+            if (params.m_renormalize && totalAmplitude > 0.f)
+            {
+                totalNoise /= totalAmplitude;
+                totalNoise = (totalNoise * .5f) + .5f;
+                totalNoise = SmoothStep3(totalNoise);
+                totalNoise = (totalNoise * 2.0f) - 1.f;
+            }
+            outNoise[lane] = totalNoise;
+        }
+    }
+}
+
+NoiseSimdLevel GetSupportedNoiseSimdLevel()
+{
+    static const NoiseSimdLevel s_supportedLevel = DetectNoiseSimdLevel();
+    return s_supportedLevel;
+}
+
+char const* GetNoiseSimdLevelName(NoiseSimdLevel level)
+{
+    switch (level)
+    {
+    case NoiseSimdLevel::SSE41: return "SSE4.1";
+    case NoiseSimdLevel::AVX2:  return "AVX2";
+    default:                    return "scalar";
+    }
+}
+
+void Compute3dPerlinNoiseRow(
+    NoiseSimdLevel level,
+    float const* posX, float posY, float posZ, int count,
+    float* outNoise,
+    float scale,
+    unsigned int numOctaves,
+    float octavePersistence,
+    float octaveScale,
+    bool renormalize,
+    unsigned int seed)
+{
+    if ((int)level > (int)GetSupportedNoiseSimdLevel())
+    {
+        level = GetSupportedNoiseSimdLevel();
+    }
+
+    const PerlinParams params = { scale, numOctaves, octavePersistence, octaveScale, renormalize, seed };
+    for (int start = 0; start < count; start += NOISE_BATCH_SIZE)
+    {
+        const int batchCount = (count - start < NOISE_BATCH_SIZE) ? count - start : NOISE_BATCH_SIZE;
+        switch (level)
+        {
+        case NoiseSimdLevel::AVX2:
+            ComputePerlinBatch<LanesAvx2>(posX + start, posY, posZ, batchCount, outNoise + start, params);
+            break;
+        case NoiseSimdLevel::SSE41:
+            ComputePerlinBatch<LanesSse41>(posX + start, posY, posZ, batchCount, outNoise + start, params);
+            break;
+        default:
+            for (int i = start; i < start + batchCount; ++i)
+            {
+                outNoise[i] = Compute3dPerlinNoise(posX[i], posY, posZ, scale, numOctaves,
+                                                   octavePersistence, octaveScale, renormalize, seed);
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+// 一次算一整行点的 3D Perlin 噪声（y、z 相同，x 各自给出），种子和参数与 Compute3dPerlinNoise 一一对应。
+// 同一行里的点在低八度落在同一个格子里，角点哈希按格子缓存；梯度点积和插值按 SIMD 宽度一起算。
+// SCALAR 就是逐点调 Compute3dPerlinNoise；SIMD 路径每一步的运算顺序和它相同、不合并成 FMA，结果逐位相同，
+// 所以存档不记录用的是哪个级别。World::VerifyBatchedNoise 要求噪声值和方块都零差异
+
+enum class NoiseSimdLevel
+{
+    SCALAR = 0,
+    SSE41,       // 4 路
+    AVX2,        // 8 路
+    COUNT
+};
+
+NoiseSimdLevel GetSupportedNoiseSimdLevel();    // 启动后第一次调用时用 cpuid 检测一次
+char const* GetNoiseSimdLevelName(NoiseSimdLevel level);
+
+// level 高于 CPU 支持的级别时自动降到支持的级别；count 不限
+void Compute3dPerlinNoiseRow(
+    NoiseSimdLevel level,
+    float const* posX, float posY, float posZ, int count,
+    float* outNoise,
+    float scale,
+    unsigned int numOctaves,
+    float octavePersistence,
+    float octaveScale,
+    bool renormalize,
+    unsigned int seed);
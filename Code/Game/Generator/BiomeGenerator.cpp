@@ -7,7 +7,8 @@
 
 extern Game* g_theGame;
 
-BiomeGenerator::BiomeGenerator(unsigned int baseSeed)
+BiomeGenerator::BiomeGenerator(unsigned int baseSeed, WorldGenSettings const& settings)
+    : m_settings(settings)
 {
     m_temperatureSeed = baseSeed + 0;
     m_humiditySeed = baseSeed + 1;
@@ -377,14 +378,27 @@ BiomeGenerator::BiomeType BiomeGenerator::DetermineBiome(const BiomeParameters&
 }
 
 BiomeGenerator::BiomeParameters BiomeGenerator::SampleBiomeParameters(int worldX, int worldY)
+{
+    BiomeParameters params = SampleRawClimate(worldX, worldY);
+    params.m_peaksAndValleys = FoldPeaksAndValleys(params.m_peaksAndValleys);
+    return params;
+}
+
+float BiomeGenerator::FoldPeaksAndValleys(float rawPV)
+{
+    // PV = 1 - |3|N| - 2|
+    return 1.0f - fabsf(3.0f * fabsf(rawPV) - 2.0f);
+}
+
+BiomeGenerator::BiomeParameters BiomeGenerator::SampleRawClimate(int worldX, int worldY)
 {
     BiomeParameters params;
     
     // Continent: Scale = 1024.0, Octaves = 4
     params.m_continentalness = Compute2dPerlinNoise(
         (float)worldX, (float)worldY,
-        g_theGame->g_continentNoiseScale, // Scale= 1024 
-        g_theGame->g_continentNoiseOctaves,        
+        m_settings.m_continentNoiseScale, // Scale= 1024 
+        m_settings.m_continentNoiseOctaves,        
         0.5f,     
         2.0f,     
         true,
@@ -394,8 +408,8 @@ BiomeGenerator::BiomeParameters BiomeGenerator::SampleBiomeParameters(int worldX
     // Temperature: Scale = 512.0, Octaves = 2
     params.m_temperature = Compute2dPerlinNoise(
         (float)worldX, (float)worldY,
-        g_theGame->g_temperatureNoiseScale,   // Scale = 512
-        g_theGame->g_temperatureNoiseOctaves,        // Octaves = 2
+        m_settings.m_temperatureNoiseScale,   // Scale = 512
+        m_settings.m_temperatureNoiseOctaves,        // Octaves = 2
         0.5f,
         2.0f,
         true,
@@ -405,8 +419,8 @@ BiomeGenerator::BiomeParameters BiomeGenerator::SampleBiomeParameters(int worldX
     // Humidity: Scale = 512.0, Octaves = 4
     params.m_humidity = Compute2dPerlinNoise(
         (float)worldX, (float)worldY,
-        g_theGame->g_humidityNoiseScale,   // Scale = 512
-        g_theGame->g_humidityNoiseOctaves,        // Octaves = 4
+        m_settings.m_humidityNoiseScale,   // Scale = 512
+        m_settings.m_humidityNoiseOctaves,        // Octaves = 4
         0.5f,
         2.0f,
         true,
@@ -416,8 +430,8 @@ BiomeGenerator::BiomeParameters BiomeGenerator::SampleBiomeParameters(int worldX
     // Erosion: Scale = 512.0, Octaves = 8
     params.m_erosion = Compute2dPerlinNoise(
         (float)worldX, (float)worldY,
-        g_theGame->g_erosionNoiseScale,   // Scale = 512
-        g_theGame->g_erosionNoiseOctaves,        // Octaves = 8
+        m_settings.m_erosionNoiseScale,   // Scale = 512
+        m_settings.m_erosionNoiseOctaves,        // Octaves = 8
         0.5f,
         2.0f,
         true,
@@ -436,18 +450,15 @@ BiomeGenerator::BiomeParameters BiomeGenerator::SampleBiomeParameters(int worldX
     );
     
     // Peaks and Valleys: Scale = 512.0, Octaves = 8
-    float rawPV = Compute2dPerlinNoise(
+    params.m_peaksAndValleys = Compute2dPerlinNoise(
         (float)worldX, (float)worldY,
-        g_theGame->g_humidityNoiseScale,   // Scale = 512
-        g_theGame->g_peaksValleysNoiseOctaves,        // Octaves = 8
+        m_settings.m_humidityNoiseScale,   // Scale = 512
+        m_settings.m_peaksValleysNoiseOctaves,        // Octaves = 8
         0.5f,
         2.0f,
         true,
         m_peaksValleysSeed
     );
     
-    // PV = 1 - |3|N| - 2|
-    params.m_peaksAndValleys = 1.0f - fabsf(3.0f * fabsf(rawPV) - 2.0f);
-    
     return params;
 }
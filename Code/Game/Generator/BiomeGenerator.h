@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "WorldGenSettings.h"
 
 enum ContinentalnessType
 {
@@ -69,7 +70,7 @@ public:
         float m_peaksAndValleys;   
     };
 
-    BiomeGenerator(unsigned int baseSeed);
+    BiomeGenerator(unsigned int baseSeed, WorldGenSettings const& settings);
     ~BiomeGenerator();
     
     ContinentalnessType ClassifyContinentalness(float c);
@@ -86,8 +87,12 @@ public:
     BiomeType DetermineBiome(const BiomeParameters& params);
     
     BiomeParameters SampleBiomeParameters(int worldX, int worldY);
+    // 六个噪声场的原始值，m_peaksAndValleys 是折叠前的噪声；气候网格插值原始值后再折叠，峰谷的尖角不会被抹平
+    BiomeParameters SampleRawClimate(int worldX, int worldY);
+    static float FoldPeaksAndValleys(float rawPV);
     
     BiomeParameters m_biomeParameters;
+    WorldGenSettings const& m_settings;   // 所在 WorldGenPipeline 的那一份
     unsigned int m_temperatureSeed;
     unsigned int m_humiditySeed;
     unsigned int m_continentalSeed;
@@ -3,93 +3,251 @@
 #include "WorldGenPipeline.h"
 #include "Game/Block.h"
 #include "Game/ChunkUtils.h"
+#include "Engine/Math/MathUtils.hpp"
 #include "ThirdParty/Noise/SmoothNoise.hpp"
 
 extern Game* g_theGame;
 
-CaveGenerator::CaveGenerator(unsigned int seed)
-    : m_cheeseSeed(seed)
+// noodle 洞只出现在这个高度以下
+static constexpr int NOODLE_MAX_Z = 50;
+
+CaveGenerator::CaveGenerator(unsigned int seed, WorldGenSettings const& settings)
+    : m_settings(settings)
+    , m_cheeseSeed(seed)
     , m_spaghettiSeed(seed + 1000)
     , m_noodleSeed(seed + 2000)
     , m_densitySeed(seed + 3000)
 {
 }
 
-bool CaveGenerator::IsInCave(const Vec3& worldPos, int distanceToSurface, float terrainHeight, 
-                             float* outCaveness, CaveType* outDominantType)
+void CaveGenerator::SampleNoiseRow(NoiseSimdLevel noiseLevel, const float* worldX, int count, float scaleX, float posY, float posZ,
+                                   unsigned int numOctaves, float persistence, bool renormalize, unsigned int seed, float* outNoise)
+{
+    // 各层噪声把世界坐标先乘自己的频率再以 scale 1 采样，x 也按原来的方式逐点乘好
+    float scaledX[CHUNK_SIZE_X];
+    for (int i = 0; i < count; i++)
+    {
+        scaledX[i] = worldX[i] * scaleX;
+    }
+    Compute3dPerlinNoiseRow(noiseLevel, scaledX, posY, posZ, count, outNoise,
+                            1.0f, numOctaves, persistence, 2.0f, renormalize, seed);
+}
+
+void CaveGenerator::SampleCaveNoiseRow(CaveRow& row, float worldY, float worldZ, NoiseSimdLevel noiseLevel)
 {
-    UNUSED(outDominantType);
-    UNUSED(terrainHeight)
-    //float seaLevel = (float)g_theGame->g_seaLevel;
+    // === CHEESE CAVES (Large Rooms) ===
+    // Use 3D noise to create large spherical voids; fewer octaves for smoother shapes
+    SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.014f, worldY * 0.014f, worldZ * 0.014f, 2, 0.5f, false, m_cheeseSeed, row.m_cheese);
+    
+    // Add a second layer for variation (stretched vertically)
+    SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.01f, worldY * 0.01f, worldZ * 0.008f, 1, 0.5f, false, m_cheeseSeed + 1337, row.m_cheese2);
+    
+    // === SPAGHETTI CAVES (Tunnels) ===
+    // Minecraft uses 2D noise sampled at different angles to create tunnels
+    SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.025f, worldY * 0.025f, 0.0f, 3, 0.4f, false, m_spaghettiSeed, row.m_spaghetti1);          // XY plane
+    SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.025f, 0.0f, worldZ * 0.025f, 3, 0.4f, false, m_spaghettiSeed + 100, row.m_spaghetti2);    // XZ plane
     
-    // Basic bounds checking
-    if (worldPos.z < 5 || worldPos.z > 200) return false;
-    if (distanceToSurface < 8) return false;
+    // === NOODLE CAVES (Thin tunnels) ===
+    // Ridge noise for more chaotic shapes
+    SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.035f, worldY * 0.035f, worldZ * 0.035f, 2, 0.6f, true, m_noodleSeed, row.m_noodle);
+}
+
+bool CaveGenerator::IsCarvableBlock(uint8_t blockType)
+{
+    // Only carve through solid blocks
+    return blockType == BLOCK_TYPE_STONE || blockType == BLOCK_TYPE_DIRT || blockType == BLOCK_TYPE_SAND;
+}
+
+void CaveGenerator::ComputeCaveColumns(const Block* blocks, CaveColumns& outColumns, int& outMinZ, int& outMaxZ)
+{
+    // 和 CalculateDistanceToSurface 的定义一致：往上数连续的非空气/水方块，最顶一格为 0。
+    // 从上往下扫时，下一格的距离就是这一格的距离 + 1（这一格是空气/水则归零），一列 O(高度)
+    const int minZ = MaxI(CAVE_MIN_Z, 2);
+    const int maxZ = MinI(CAVE_MAX_Z, CHUNK_SIZE_Z - 2);
+    outMinZ = CHUNK_SIZE_Z;
+    outMaxZ = -1;
+    for (int y = 0; y < CHUNK_SIZE_Y; y++)
+    {
+        for (int x = 0; x < CHUNK_SIZE_X; x++)
+        {
+            int minCandidateZ = CHUNK_SIZE_Z;
+            int maxCandidateZ = -1;
+            int distance = 0;
+            for (int z = CHUNK_SIZE_Z - 1; z >= 0; z--)
+            {
+                int idx = LocalCoordsToIndex(x, y, z);
+                uint8_t blockType = blocks[idx].m_typeIndex;
+                outColumns.m_surfaceDistance[idx] = (uint8_t)distance;
+                if (z >= minZ && z <= maxZ && distance >= CAVE_MIN_SURFACE_DISTANCE && IsCarvableBlock(blockType))
+                {
+                    minCandidateZ = z;
+                    maxCandidateZ = MaxI(maxCandidateZ, z);
+                }
+                distance = (blockType == BLOCK_TYPE_AIR || blockType == BLOCK_TYPE_WATER) ? 0 : distance + 1;
+            }
+            outColumns.m_minCandidateZ[x][y] = minCandidateZ;
+            outColumns.m_maxCandidateZ[x][y] = maxCandidateZ;
+            if (minCandidateZ <= maxCandidateZ)
+            {
+                outMinZ = MinI(outMinZ, minCandidateZ);
+                outMaxZ = MaxI(outMaxZ, maxCandidateZ);
+            }
+        }
+    }
+}
+
+void CaveGenerator::SampleCaveNoiseLattice(const IntVec2& chunkCoords, const CaveColumns& columns, NoiseSimdLevel noiseLevel, CaveNoiseLattice& outLattice)
+{
+    const int baseWorldX = chunkCoords.x * CHUNK_SIZE_X;
+    const int baseWorldY = chunkCoords.y * CHUNK_SIZE_Y;
     
+    // 格子里有候选方块才需要它四个角上的格点：先求每个格子的候选 z 范围，再摊到四个角上的 k 范围
+    for (int j = 0; j < CAVE_LATTICE_SIZE_Y; j++)
+    {
+        for (int i = 0; i < CAVE_LATTICE_SIZE_X; i++)
+        {
+            outLattice.m_pointMinK[j][i] = CAVE_LATTICE_SIZE_Z;
+            outLattice.m_pointMaxK[j][i] = -1;
+        }
+    }
+    for (int cellJ = 0; cellJ < CAVE_LATTICE_SIZE_Y - 1; cellJ++)
+    {
+        for (int cellI = 0; cellI < CAVE_LATTICE_SIZE_X - 1; cellI++)
+        {
+            int cellMinZ = CHUNK_SIZE_Z;
+            int cellMaxZ = -1;
+            for (int y = cellJ * CAVE_CELL_SIZE_XY; y < (cellJ + 1) * CAVE_CELL_SIZE_XY; y++)
+            {
+                for (int x = cellI * CAVE_CELL_SIZE_XY; x < (cellI + 1) * CAVE_CELL_SIZE_XY; x++)
+                {
+                    if (columns.m_minCandidateZ[x][y] > columns.m_maxCandidateZ[x][y])
+                        continue;
+                    cellMinZ = MinI(cellMinZ, columns.m_minCandidateZ[x][y]);
+                    cellMaxZ = MaxI(cellMaxZ, columns.m_maxCandidateZ[x][y]);
+                }
+            }
+            if (cellMinZ > cellMaxZ)
+                continue;
+            
+            // z 落在 [k*4, k*4+3] 的方块用第 k 和 k+1 层格点
+            int minK = cellMinZ / CAVE_CELL_SIZE_Z;
+            int maxK = cellMaxZ / CAVE_CELL_SIZE_Z + 1;
+            for (int j = cellJ; j <= cellJ + 1; j++)
+            {
+                for (int i = cellI; i <= cellI + 1; i++)
+                {
+                    outLattice.m_pointMinK[j][i] = MinI(outLattice.m_pointMinK[j][i], minK);
+                    outLattice.m_pointMaxK[j][i] = MaxI(outLattice.m_pointMaxK[j][i], maxK);
+                }
+            }
+        }
+    }
+    
+    // 格点上的频率、八度和逐格采样时完全相同，只是采样位置落在格点上
+    int rowLatticeI[CAVE_LATTICE_SIZE_X];
+    float rowWorldX[CAVE_LATTICE_SIZE_X];
+    float rowNoise[CAVE_LATTICE_SIZE_X];
+    for (int k = 0; k < CAVE_LATTICE_SIZE_Z; k++)
+    {
+        float worldZ = (float)(k * CAVE_CELL_SIZE_Z);
+        // noodle 只在 NOODLE_MAX_Z 以下起作用，用不到的上层格点不采
+        bool needsNoodle = (k - 1) * CAVE_CELL_SIZE_Z < NOODLE_MAX_Z;
+        for (int j = 0; j < CAVE_LATTICE_SIZE_Y; j++)
+        {
+            int count = 0;
+            for (int i = 0; i < CAVE_LATTICE_SIZE_X; i++)
+            {
+                if (k >= outLattice.m_pointMinK[j][i] && k <= outLattice.m_pointMaxK[j][i])
+                {
+                    rowLatticeI[count] = i;
+                    rowWorldX[count] = (float)(baseWorldX + i * CAVE_CELL_SIZE_XY);
+                    count++;
+                }
+            }
+            if (count == 0)
+                continue;
+            
+            float worldY = (float)(baseWorldY + j * CAVE_CELL_SIZE_XY);
+            SampleNoiseRow(noiseLevel, rowWorldX, count, 0.014f, worldY * 0.014f, worldZ * 0.014f, 2, 0.5f, false, m_cheeseSeed, rowNoise);
+            for (int n = 0; n < count; n++)
+            {
+                outLattice.m_cheese[k][j][rowLatticeI[n]] = rowNoise[n];
+            }
+            SampleNoiseRow(noiseLevel, rowWorldX, count, 0.01f, worldY * 0.01f, worldZ * 0.008f, 1, 0.5f, false, m_cheeseSeed + 1337, rowNoise);
+            for (int n = 0; n < count; n++)
+            {
+                outLattice.m_cheese2[k][j][rowLatticeI[n]] = rowNoise[n];
+            }
+            if (needsNoodle)
+            {
+                SampleNoiseRow(noiseLevel, rowWorldX, count, 0.035f, worldY * 0.035f, worldZ * 0.035f, 2, 0.6f, true, m_noodleSeed, rowNoise);
+                for (int n = 0; n < count; n++)
+                {
+                    outLattice.m_noodle[k][j][rowLatticeI[n]] = rowNoise[n];
+                }
+            }
+        }
+    }
+    
+    // XY 平面的 spaghetti 不随 z 变，每列采一次（结果和逐格采样逐位相同）
+    float chunkWorldX[CHUNK_SIZE_X];
+    for (int x = 0; x < CHUNK_SIZE_X; x++)
+    {
+        chunkWorldX[x] = (float)(baseWorldX + x);
+    }
+    for (int y = 0; y < CHUNK_SIZE_Y; y++)
+    {
+        float worldY = (float)(baseWorldY + y);
+        SampleNoiseRow(noiseLevel, chunkWorldX, CHUNK_SIZE_X, 0.025f, worldY * 0.025f, 0.0f, 3, 0.4f, false, m_spaghettiSeed, outLattice.m_spaghetti1[y]);
+    }
+}
+
+static float InterpolateCaveLattice(const float lattice[CAVE_LATTICE_SIZE_Z][CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X],
+                                    int i, int j, int k, float tx, float ty, float tz)
+{
+    float south = Interpolate(Interpolate(lattice[k][j][i], lattice[k][j][i + 1], tx),
+                              Interpolate(lattice[k][j + 1][i], lattice[k][j + 1][i + 1], tx), ty);
+    float north = Interpolate(Interpolate(lattice[k + 1][j][i], lattice[k + 1][j][i + 1], tx),
+                              Interpolate(lattice[k + 1][j + 1][i], lattice[k + 1][j + 1][i + 1], tx), ty);
+    return Interpolate(south, north, tz);
+}
+
+void CaveGenerator::InterpolateCaveNoiseRow(CaveRow& row, const CaveNoiseLattice& lattice, int y, int z, const float* spaghetti2)
+{
+    int j = y / CAVE_CELL_SIZE_XY;
+    float ty = (float)(y - j * CAVE_CELL_SIZE_XY) / (float)CAVE_CELL_SIZE_XY;
+    int k = z / CAVE_CELL_SIZE_Z;
+    float tz = (float)(z - k * CAVE_CELL_SIZE_Z) / (float)CAVE_CELL_SIZE_Z;
+    for (int n = 0; n < row.m_count; n++)
+    {
+        int x = row.m_localX[n];
+        int i = x / CAVE_CELL_SIZE_XY;
+        float tx = (float)(x - i * CAVE_CELL_SIZE_XY) / (float)CAVE_CELL_SIZE_XY;
+        row.m_cheese[n] = InterpolateCaveLattice(lattice.m_cheese, i, j, k, tx, ty, tz);
+        row.m_cheese2[n] = InterpolateCaveLattice(lattice.m_cheese2, i, j, k, tx, ty, tz);
+        // NOODLE_MAX_Z 以上 IsInCave 不看 noodle，那里的格点也没采
+        row.m_noodle[n] = z < NOODLE_MAX_Z ? InterpolateCaveLattice(lattice.m_noodle, i, j, k, tx, ty, tz) : 1.0f;
+        row.m_spaghetti1[n] = lattice.m_spaghetti1[y][x];
+        row.m_spaghetti2[n] = spaghetti2[x];
+    }
+}
+
+bool CaveGenerator::IsInCave(const CaveRow& row, int i, float worldZ, float* outCaveness)
+{
     // Calculate depth factor for cave frequency
     float depthFactor = 1.0f;
-    if (worldPos.z > 60) {
+    if (worldZ > 60) {
         // Caves become rarer near surface
-        depthFactor = RangeMap(worldPos.z, 60.0f, 80.0f, 1.0f, 0.1f);
+        depthFactor = RangeMap(worldZ, 60.0f, 80.0f, 1.0f, 0.1f);
     }
     
-    // === CHEESE CAVES (Large Rooms) ===
-    // Use 3D noise to create large spherical voids
-    float cheeseNoise = Compute3dPerlinNoise(
-        worldPos.x * 0.014f,  // Scale factor for size
-        worldPos.y * 0.014f, 
-        worldPos.z * 0.014f,
-        1.0f,  // Base frequency
-        2,     // Fewer octaves for smoother shapes
-        0.5f,  // Persistence
-        2.0f,  // Lacunarity
-        false, // No ridge
-        m_cheeseSeed
-    );
-    
-    // Add a second layer for variation
-    float cheeseNoise2 = Compute3dPerlinNoise(
-        worldPos.x * 0.01f,
-        worldPos.y * 0.01f,
-        worldPos.z * 0.008f,  // Stretch vertically
-        1.0f, 1, 0.5f, 2.0f, false, 
-        m_cheeseSeed + 1337
-    );
-    
     // Combine cheese noises
-    float cheeseDensity = (cheeseNoise * 0.7f + cheeseNoise2 * 0.3f) + 0.05f;
-    
-    // === SPAGHETTI CAVES (Tunnels) ===
-    // Minecraft uses 2D noise sampled at different angles to create tunnels
-    float spaghetti1 = Compute3dPerlinNoise(
-        worldPos.x * 0.025f,
-        worldPos.y * 0.025f,
-        0.0f,  // 2D noise in XY plane
-        1.0f, 3, 0.4f, 2.0f, false,
-        m_spaghettiSeed
-    );
-    
-    float spaghetti2 = Compute3dPerlinNoise(
-        worldPos.x * 0.025f,
-        0.0f,
-        worldPos.z * 0.025f,  // 2D noise in XZ plane
-        1.0f, 3, 0.4f, 2.0f, false,
-        m_spaghettiSeed + 100
-    );
+    float cheeseDensity = (row.m_cheese[i] * 0.7f + row.m_cheese2[i] * 0.3f) + 0.05f;
     
     // Create tunnel by finding where BOTH noise values are near zero
-    float spaghettiDensity = fabsf(spaghetti1) + fabsf(spaghetti2);
-    
-    // === NOODLE CAVES (Thin tunnels) ===
-    float noodle1 = Compute3dPerlinNoise(
-        worldPos.x * 0.035f,
-        worldPos.y * 0.035f,
-        worldPos.z * 0.035f,
-        1.0f, 2, 0.6f, 2.0f, true,  // Ridge noise for more chaotic shapes
-        m_noodleSeed
-    );
+    float spaghettiDensity = fabsf(row.m_spaghetti1[i]) + fabsf(row.m_spaghetti2[i]);
     
-    float noodleDensity = fabsf(noodle1);
+    float noodleDensity = fabsf(row.m_noodle[i]);
     
     // === COMBINE ALL CAVE TYPES ===
     bool inCave = false;
@@ -110,7 +268,7 @@ bool CaveGenerator::IsInCave(const Vec3& worldPos, int distanceToSurface, float
     }
     
     // Noodle caves - thin threshold
-    if (noodleDensity < 0.08f && worldPos.z < 50) {  // Noodles mainly at depth
+    if (noodleDensity < 0.08f && worldZ < NOODLE_MAX_Z) {  // Noodles mainly at depth
         inCave = true;
         caveness = MaxF(caveness, (0.08f - noodleDensity) * 8.0f);
     }
@@ -118,200 +276,194 @@ bool CaveGenerator::IsInCave(const Vec3& worldPos, int distanceToSurface, float
     // Apply depth factor
     caveness *= depthFactor;
     
-    // Add aquifer caves (flooded caves at certain depths)
-    if (worldPos.z < 30 && inCave) {
-        // Some caves at depth should be flooded
-        float floodNoise = Compute3dPerlinNoise(
-            worldPos.x * 0.05f,
-            worldPos.y * 0.05f,
-            worldPos.z * 0.1f,
-            1.0f, 1, 0.5f, 2.0f, false,
-            m_densitySeed
-        );
-        
-        if (floodNoise > 0.3f) {
-            // This cave section will be water-filled
-            // (Handle this in CarveCaves method)
-        }
-    }
-    
     if (outCaveness)
         *outCaveness = caveness;
-    
     return inCave;
 }
-void CaveGenerator::CarveCaves(Block* blocks, const IntVec2& chunkCoords, const ChunkGenData& chunkGenData)
+
+void CaveGenerator::CarveCaves(Block* blocks, const IntVec2& chunkCoords, const ChunkGenData& chunkGenData, const CaveCarveOptions& options)
 {
-    // int caveCount = 0;
-    // int airCaveCount = 0;
-    // int waterCaveCount = 0;
-    // int lavaCaveCount = 0;
-    //
-    // int cheeseCount = 0;
-    // int spaghettiCount = 0;
-    // int noodleCount = 0;
-    //
-    float seaLevel = (float)g_theGame->g_seaLevel;
+    float seaLevel = (float)m_settings.m_seaLevel;
+    CaveRow row;
     
-    // Process each block in the chunk
-    for (int z = 2; z < CHUNK_SIZE_Z - 1; z++)
+    // 到地表的距离每列扫一遍就够；顺带得到整个 chunk 里可能挖洞的 z 范围，范围外的行整行跳过
+    CaveColumns columns;
+    int minZ = MaxI(CAVE_MIN_Z, 2);
+    int maxZ = MinI(CAVE_MAX_Z, CHUNK_SIZE_Z - 2);
+    if (options.m_useColumnSurfaceDistance || options.m_useCoarseNoise)
     {
+        ComputeCaveColumns(blocks, columns, minZ, maxZ);
+    }
+    
+    CaveNoiseLattice lattice;
+    if (options.m_useCoarseNoise && minZ <= maxZ)
+    {
+        SampleCaveNoiseLattice(chunkCoords, columns, options.m_noiseLevel, lattice);
+    }
+    float chunkWorldX[CHUNK_SIZE_X];
+    for (int x = 0; x < CHUNK_SIZE_X; x++)
+    {
+        chunkWorldX[x] = (float)(chunkCoords.x * CHUNK_SIZE_X + x);
+    }
+    
+    // Process each row of the chunk: 先挑出这一行要判断的方块（不可能挖的在算噪声前就排除），再把各层噪声成行算出来
+    for (int z = minZ; z <= maxZ; z++)
+    {
+        float worldZ = (float)z;
+        
+        // XZ 平面的 spaghetti 只随 x、z 变，粗格点模式下这一层第一次用到时整行采一次
+        float spaghetti2[CHUNK_SIZE_X];
+        bool hasSpaghetti2 = false;
+        
         for (int y = 0; y < CHUNK_SIZE_Y; y++)
         {
+            float worldY = (float)(chunkCoords.y * CHUNK_SIZE_Y + y);
+            row.m_count = 0;
             for (int x = 0; x < CHUNK_SIZE_X; x++)
             {
                 int idx = LocalCoordsToIndex(x, y, z);
-                
-                // Only carve through solid blocks
-                if (blocks[idx].m_typeIndex != BLOCK_TYPE_STONE &&
-                    blocks[idx].m_typeIndex != BLOCK_TYPE_DIRT &&
-                    blocks[idx].m_typeIndex != BLOCK_TYPE_SAND )
-                {
+                if (!IsCarvableBlock(blocks[idx].m_typeIndex))
                     continue;
-                }
-                
-                // Calculate world coordinates
-                float worldX = (float)(chunkCoords.x * CHUNK_SIZE_X + x);
-                float worldY = (float)(chunkCoords.y * CHUNK_SIZE_Y + y);
-                float worldZ = (float)z;
-                Vec3 worldPos(worldX, worldY, worldZ);
                 
-                // Get terrain height from chunk gen data
-                float terrainHeight = (float)chunkGenData.m_surfaceHeights[x][y];
-                
-                // Calculate distance to surface
-                int distanceToSurface = CalculateDistanceToSurface(blocks, x, y, z);
+                // 只往上看，本行还没雕的方块不影响结果
+                int distanceToSurface = options.m_useColumnSurfaceDistance ?
+                    (int)columns.m_surfaceDistance[idx] : CalculateDistanceToSurface(blocks, x, y, z);
+                if (distanceToSurface < CAVE_MIN_SURFACE_DISTANCE)
+                    continue;
                 
-                // Check if this position should be a cave
-                float caveness = 0.0f;
-                if (!IsInCave(worldPos, distanceToSurface, terrainHeight, &caveness))
+                row.m_localX[row.m_count] = x;
+                row.m_worldX[row.m_count] = chunkWorldX[x];
+                row.m_terrainHeight[row.m_count] = (float)chunkGenData.m_surfaceHeights[x][y];
+                row.m_count++;
+            }
+            if (row.m_count == 0)
+                continue;
+            
+            if (options.m_useCoarseNoise)
+            {
+                if (!hasSpaghetti2)
                 {
-                    continue;
+                    SampleNoiseRow(options.m_noiseLevel, chunkWorldX, CHUNK_SIZE_X, 0.025f, 0.0f, worldZ * 0.025f, 3, 0.4f, false, m_spaghettiSeed + 100, spaghetti2);
+                    hasSpaghetti2 = true;
                 }
+                InterpolateCaveNoiseRow(row, lattice, y, z, spaghetti2);
+            }
+            else
+            {
+                SampleCaveNoiseRow(row, worldY, worldZ, options.m_noiseLevel);
+            }
+            
+            // 只留下在洞里的方块（原地压缩），再一起决定填充物
+            int numInCave = 0;
+            for (int i = 0; i < row.m_count; i++)
+            {
+                float caveness = 0.0f;
+                if (!IsInCave(row, i, worldZ, &caveness))
+                    continue;
                 
-                //caveCount++;
-                
-                // Determine what to fill the cave with based on depth and conditions
-                uint8_t fillBlock = DetermineCaveFill(worldPos, terrainHeight, seaLevel, caveness);
-                
-                blocks[idx].SetType(fillBlock);
-                
-                // // Statistics tracking
-                // switch (fillBlock)
-                // {
-                //     case BLOCK_TYPE_AIR:
-                //         airCaveCount++;
-                //         break;
-                //     case BLOCK_TYPE_WATER:
-                //         waterCaveCount++;
-                //         break;
-                //     case BLOCK_TYPE_LAVA:
-                //         lavaCaveCount++;
-                //         break;
-                // }
-                
-                // Track cave type statistics
-                // if (caveness > 0.7f)
-                //     cheeseCount++;
-                // else if (caveness > 0.4f)
-                //     spaghettiCount++;
-                // else
-                //     noodleCount++;
+                row.m_localX[numInCave] = row.m_localX[i];
+                row.m_worldX[numInCave] = row.m_worldX[i];
+                row.m_terrainHeight[numInCave] = row.m_terrainHeight[i];
+                row.m_caveness[numInCave] = caveness;
+                numInCave++;
+            }
+            row.m_count = numInCave;
+            if (row.m_count == 0)
+                continue;
+            
+            // Determine what to fill the cave with based on depth and conditions
+            DetermineCaveFillRow(row, worldY, worldZ, seaLevel, options.m_noiseLevel);
+            for (int i = 0; i < row.m_count; i++)
+            {
+                blocks[LocalCoordsToIndex(row.m_localX[i], y, z)].SetType(row.m_fill[i]);
             }
         }
     }
     
     // Post-process for better water flow and lava pools TODO
     PostProcessLiquids(blocks, chunkCoords);
-    
-    // // Debug output
-    // if (caveCount > 0)
-    // {
-    //     DebuggerPrintf("Chunk(%d,%d): %d caves | Air:%d Water:%d Lava:%d | Cheese:%d Spaghetti:%d Noodle:%d\n",
-    //                    chunkCoords.x, chunkCoords.y,
-    //                    caveCount, airCaveCount, waterCaveCount, lavaCaveCount,
-    //                    cheeseCount, spaghettiCount, noodleCount);
-    // }
 }
 
-uint8_t CaveGenerator::DetermineCaveFill(const Vec3& worldPos, float terrainHeight, float seaLevel, float caveness)
+void CaveGenerator::DetermineCaveFillRow(CaveRow& row, float worldY, float worldZ, float seaLevel, NoiseSimdLevel noiseLevel)
 {
+    // 一行里 z 相同，走哪个深度分支整行一样；需要噪声的点成行算
+    float fillNoise[CHUNK_SIZE_X];
+    
     // Lava layer (very deep)
-    if (worldPos.z < 15)
+    if (worldZ < 15)
     {
         // All caves at lava depth are filled with lava
-        return BLOCK_TYPE_LAVA;
+        for (int i = 0; i < row.m_count; i++)
+        {
+            row.m_fill[i] = BLOCK_TYPE_LAVA;
+        }
+        return;
     }
     
     // Deep aquifer layer (11-30)
-    if (worldPos.z < 30)
+    if (worldZ < 30)
     {
         // Use noise to determine water vs air pockets
-        float aquiferNoise = Compute3dPerlinNoise(
-            worldPos.x * 0.02f,
-            worldPos.y * 0.02f,
-            worldPos.z * 0.05f,
-            1.0f, 2, 0.5f, 2.0f, false,
-            m_densitySeed + 5000
-        );
-        
-        // Large caves more likely to have air pockets
-        float airChance = caveness * 0.5f;
-        
-        if (aquiferNoise + airChance > 0.3f)
-        {
-            return BLOCK_TYPE_AIR;
-        }
-        else
+        SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.02f, worldY * 0.02f, worldZ * 0.05f, 2, 0.5f, false, m_densitySeed + 5000, fillNoise);
+        for (int i = 0; i < row.m_count; i++)
         {
-            return BLOCK_TYPE_WATER;
+            // Large caves more likely to have air pockets
+            float airChance = row.m_caveness[i] * 0.5f;
+            row.m_fill[i] = (fillNoise[i] + airChance > 0.3f) ? BLOCK_TYPE_AIR : BLOCK_TYPE_WATER;
         }
+        return;
     }
     
     // Mid-level caves (30-50)
-    if (worldPos.z < 50)
+    if (worldZ < 50)
     {
         // Occasional water pools in large caves
-        if (caveness > 0.8f)
+        bool hasLargeCave = false;
+        for (int i = 0; i < row.m_count; i++)
         {
-            float poolNoise = Compute3dPerlinNoise(
-                worldPos.x * 0.04f,
-                worldPos.y * 0.04f,
-                worldPos.z * 0.1f,
-                1.0f, 1, 0.5f, 2.0f, false,
-                m_densitySeed + 7000
-            );
-            
-            if (poolNoise > 0.7f)
-            {
-                return BLOCK_TYPE_WATER;
-            }
+            hasLargeCave = hasLargeCave || row.m_caveness[i] > 0.8f;
+        }
+        if (hasLargeCave)
+        {
+            SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.04f, worldY * 0.04f, worldZ * 0.1f, 1, 0.5f, false, m_densitySeed + 7000, fillNoise);
+        }
+        for (int i = 0; i < row.m_count; i++)
+        {
+            row.m_fill[i] = (row.m_caveness[i] > 0.8f && fillNoise[i] > 0.7f) ? BLOCK_TYPE_WATER : BLOCK_TYPE_AIR;
         }
-        return BLOCK_TYPE_AIR;
+        return;
     }
     
     // Check if below sea level in ocean areas
-    if (worldPos.z < seaLevel && terrainHeight < seaLevel - 5.0f)
+    bool hasOceanColumn = false;
+    for (int i = 0; i < row.m_count; i++)
+    {
+        hasOceanColumn = hasOceanColumn || row.m_terrainHeight[i] < seaLevel - 5.0f;
+    }
+    if (worldZ < seaLevel && hasOceanColumn)
     {
         // Underwater caves in ocean biomes
-        float drainageNoise = Compute3dPerlinNoise(
-            worldPos.x * 0.03f,
-            worldPos.y * 0.03f,
-            worldPos.z * 0.06f,
-            1.0f, 2, 0.5f, 2.0f, false,
-            m_densitySeed + 8000
-        );
-        
-        // Some underwater caves can have air pockets
-        if (drainageNoise > 0.6f && caveness > 0.6f)
+        SampleNoiseRow(noiseLevel, row.m_worldX, row.m_count, 0.03f, worldY * 0.03f, worldZ * 0.06f, 2, 0.5f, false, m_densitySeed + 8000, fillNoise);
+        for (int i = 0; i < row.m_count; i++)
         {
-            return BLOCK_TYPE_AIR;
+            if (row.m_terrainHeight[i] < seaLevel - 5.0f)
+            {
+                // Some underwater caves can have air pockets
+                row.m_fill[i] = (fillNoise[i] > 0.6f && row.m_caveness[i] > 0.6f) ? BLOCK_TYPE_AIR : BLOCK_TYPE_WATER;
+            }
+            else
+            {
+                row.m_fill[i] = BLOCK_TYPE_AIR;
+            }
         }
-        return BLOCK_TYPE_WATER;
+        return;
     }
     
     // Normal caves above water table
-    return BLOCK_TYPE_AIR;
+    for (int i = 0; i < row.m_count; i++)
+    {
+        row.m_fill[i] = BLOCK_TYPE_AIR;
+    }
 }
 
 void CaveGenerator::PostProcessLiquids(Block* blocks, const IntVec2& chunkCoords)
@@ -1,7 +1,10 @@
 ﻿#pragma once
 
+#include "BatchedNoise.h"
+#include "WorldGenSettings.h"
 #include "Engine/Math/Vec3.hpp"
 #include "Engine/Math/IntVec2.hpp"
+#include "Game/Gamecommon.hpp"
 
 class Block;
 struct ChunkGenData;
@@ -14,25 +17,88 @@ enum CaveType
     CAVE_TYPE_NOODLE = 3
 };
 
+// 只有 z 在这个范围内、且上方至少有这么多格实心方块的石头/泥土/沙子才可能被挖成洞
+constexpr int CAVE_MIN_Z = 5;
+constexpr int CAVE_MAX_Z = 200;
+constexpr int CAVE_MIN_SURFACE_DISTANCE = 8;
+
+// cheese/noodle 的粗格点：按世界坐标对齐，每个 chunk 5x5x33 个点，格内三线性插值
+constexpr int CAVE_CELL_SIZE_XY = 4;
+constexpr int CAVE_CELL_SIZE_Z = 4;
+constexpr int CAVE_LATTICE_SIZE_X = CHUNK_SIZE_X / CAVE_CELL_SIZE_XY + 1;
+constexpr int CAVE_LATTICE_SIZE_Y = CHUNK_SIZE_Y / CAVE_CELL_SIZE_XY + 1;
+constexpr int CAVE_LATTICE_SIZE_Z = CHUNK_SIZE_Z / CAVE_CELL_SIZE_Z + 1;
+static_assert(CHUNK_SIZE_X % CAVE_CELL_SIZE_XY == 0 && CHUNK_SIZE_Y % CAVE_CELL_SIZE_XY == 0, "cave cells must tile a chunk");
+static_assert(CHUNK_SIZE_Z % CAVE_CELL_SIZE_Z == 0, "cave cells must tile a chunk");
+
+// 洞穴阶段的做法；基准测试会逐项关掉对比
+struct CaveCarveOptions
+{
+    NoiseSimdLevel m_noiseLevel = NoiseSimdLevel::SCALAR;
+    bool m_useColumnSurfaceDistance = true;    // 每列扫一遍求到地表距离；关掉时每格往上重扫（O(高度²)，只留作对比）
+    bool m_useCoarseNoise = true;              // cheese/noodle 在粗格点上插值，spaghetti 每个平面只采一次
+};
+
 class CaveGenerator
 {
 public:
-    CaveGenerator(unsigned int seed);
+    CaveGenerator(unsigned int seed, WorldGenSettings const& settings);
     
     // 在chunk中雕刻洞穴
-    void CarveCaves(Block* blocks, const IntVec2& chunkCoords, const ChunkGenData& chunkGenData);
-    uint8_t DetermineCaveFill(const Vec3& worldPos, float terrainHeight, float seaLevel, float caveness);
+    void CarveCaves(Block* blocks, const IntVec2& chunkCoords, const ChunkGenData& chunkGenData, const CaveCarveOptions& options);
     void PostProcessLiquids(Block* blocks, const IntVec2& chunkCoords);
 
 private:
-    bool IsInCave(const Vec3& worldPos,
-                  int distanceToSurface,
-                  float terrainHeight,
-                  float* outCaveness = nullptr,CaveType* outDominantType = {});
+    // 一行（同 y、z）里要判断的方块，各层洞穴噪声成行算好放在这里
+    struct CaveRow
+    {
+        int m_count = 0;
+        int m_localX[CHUNK_SIZE_X];
+        float m_worldX[CHUNK_SIZE_X];
+        float m_terrainHeight[CHUNK_SIZE_X];
+        float m_cheese[CHUNK_SIZE_X];
+        float m_cheese2[CHUNK_SIZE_X];
+        float m_spaghetti1[CHUNK_SIZE_X];
+        float m_spaghetti2[CHUNK_SIZE_X];
+        float m_noodle[CHUNK_SIZE_X];
+        float m_caveness[CHUNK_SIZE_X];
+        uint8_t m_fill[CHUNK_SIZE_X];
+    };
+
+    // 每列从上往下扫一遍：到地表的距离（上方连续非空气/水的方块数），以及这一列可能挖洞的 z 范围
+    struct CaveColumns
+    {
+        uint8_t m_surfaceDistance[CHUNK_TOTAL_BLOCKS];     // 按 LocalCoordsToIndex 排
+        int m_minCandidateZ[CHUNK_SIZE_X][CHUNK_SIZE_Y];   // 没有候选方块时 min > max
+        int m_maxCandidateZ[CHUNK_SIZE_X][CHUNK_SIZE_Y];
+    };
+    
+    // 粗格点模式下按 chunk 采好的噪声：cheese/noodle 是真 3D 的走格点，
+    // 两层 spaghetti 各自只随 (x, y) 或 (x, z) 变化，按平面精确采样
+    struct CaveNoiseLattice
+    {
+        int m_pointMinK[CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X];    // 每个格点实际采样的 k 范围
+        int m_pointMaxK[CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X];
+        float m_cheese[CAVE_LATTICE_SIZE_Z][CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X];
+        float m_cheese2[CAVE_LATTICE_SIZE_Z][CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X];
+        float m_noodle[CAVE_LATTICE_SIZE_Z][CAVE_LATTICE_SIZE_Y][CAVE_LATTICE_SIZE_X];
+        float m_spaghetti1[CHUNK_SIZE_Y][CHUNK_SIZE_X];    // XY 平面
+    };
+    
+    static bool IsCarvableBlock(uint8_t blockType);
+    void ComputeCaveColumns(const Block* blocks, CaveColumns& outColumns, int& outMinZ, int& outMaxZ);
+    void SampleCaveNoiseLattice(const IntVec2& chunkCoords, const CaveColumns& columns, NoiseSimdLevel noiseLevel, CaveNoiseLattice& outLattice);
+    void InterpolateCaveNoiseRow(CaveRow& row, const CaveNoiseLattice& lattice, int y, int z, const float* spaghetti2);
+    void SampleCaveNoiseRow(CaveRow& row, float worldY, float worldZ, NoiseSimdLevel noiseLevel);
+    bool IsInCave(const CaveRow& row, int i, float worldZ, float* outCaveness = nullptr);
+    void DetermineCaveFillRow(CaveRow& row, float worldY, float worldZ, float seaLevel, NoiseSimdLevel noiseLevel);
+    void SampleNoiseRow(NoiseSimdLevel noiseLevel, const float* worldX, int count, float scaleX, float posY, float posZ,
+                        unsigned int numOctaves, float persistence, bool renormalize, unsigned int seed, float* outNoise);
     
     int CalculateDistanceToSurface(Block* blocks, int x, int y, int z);
     
 private:
+    WorldGenSettings const& m_settings;   // 所在 WorldGenPipeline 的那一份
     unsigned int m_cheeseSeed;      // Cheese大空洞种子
     unsigned int m_spaghettiSeed;   // Spaghetti隧道种子
     unsigned int m_noodleSeed;      // Noodle细通道种子
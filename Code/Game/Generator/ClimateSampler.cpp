@@ -0,0 +1,135 @@
+﻿#include "ClimateSampler.h"
+
+#include "Engine/Math/MathUtils.hpp"
+
+namespace
+{
+    int FloorDivide(int value, int divisor)
+    {
+        return (value >= 0) ? value / divisor : -((-value + divisor - 1) / divisor);
+    }
+
+    uint64_t MakeRegionKey(IntVec2 const& regionCoords)
+    {
+        return ((uint64_t)(uint32_t)regionCoords.x << 32) | (uint64_t)(uint32_t)regionCoords.y;
+    }
+}
+
+ClimateSampler::ClimateSampler(BiomeGenerator& biomeGen)
+    : m_biomeGen(biomeGen)
+{
+}
+
+void ClimateSampler::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_regionsMutex);
+    m_regions.clear();
+}
+
+int ClimateSampler::GetNumCachedRegions() const
+{
+    std::lock_guard<std::mutex> lock(m_regionsMutex);
+    return (int)m_regions.size();
+}
+
+std::shared_ptr<ClimateSampler::ClimateRegion> ClimateSampler::AcquireRegion(IntVec2 const& regionCoords)
+{
+    std::lock_guard<std::mutex> lock(m_regionsMutex);
+    const uint64_t key = MakeRegionKey(regionCoords);
+    auto found = m_regions.find(key);
+    if (found != m_regions.end())
+    {
+        found->second->m_lastUsed = ++m_useCounter;
+        return found->second;
+    }
+
+    // 超过上限就丢掉最久没用的区域；别的 worker 手里还拿着的话 shared_ptr 保证它用完才释放
+    if ((int)m_regions.size() >= CLIMATE_MAX_CACHED_REGIONS)
+    {
+        auto oldest = m_regions.begin();
+        for (auto it = m_regions.begin(); it != m_regions.end(); ++it)
+        {
+            if (it->second->m_lastUsed < oldest->second->m_lastUsed)
+                oldest = it;
+        }
+        m_regions.erase(oldest);
+    }
+
+    std::shared_ptr<ClimateRegion> region = std::make_shared<ClimateRegion>();
+    region->m_lastUsed = ++m_useCounter;
+    m_regions[key] = region;
+    return region;
+}
+
+void ClimateSampler::SampleChunk(IntVec2 const& chunkCoords, BiomeGenerator::BiomeParameters outParams[CHUNK_SIZE_X][CHUNK_SIZE_Y])
+{
+    // 1. 取这个 chunk 用到的 5x5 个网格点。chunk 靠区域东/北边时最后一排点在相邻区域，最多涉及 4 个区域
+    const int firstPointX = chunkCoords.x * (CHUNK_SIZE_X / CLIMATE_GRID_SPACING);
+    const int firstPointY = chunkCoords.y * (CHUNK_SIZE_Y / CLIMATE_GRID_SPACING);
+    BiomeGenerator::BiomeParameters grid[CLIMATE_CHUNK_POINTS][CLIMATE_CHUNK_POINTS];    // [y][x]
+
+    int pointY = 0;
+    while (pointY < CLIMATE_CHUNK_POINTS)
+    {
+        const int regionY = FloorDivide(firstPointY + pointY, CLIMATE_REGION_POINTS);
+        const int endPointY = MinI(CLIMATE_CHUNK_POINTS, (regionY + 1) * CLIMATE_REGION_POINTS - firstPointY);
+        int pointX = 0;
+        while (pointX < CLIMATE_CHUNK_POINTS)
+        {
+            const int regionX = FloorDivide(firstPointX + pointX, CLIMATE_REGION_POINTS);
+            const int endPointX = MinI(CLIMATE_CHUNK_POINTS, (regionX + 1) * CLIMATE_REGION_POINTS - firstPointX);
+
+            std::shared_ptr<ClimateRegion> region = AcquireRegion(IntVec2(regionX, regionY));
+            std::lock_guard<std::mutex> lock(region->m_mutex);
+            for (int py = pointY; py < endPointY; ++py)
+            {
+                const int localY = firstPointY + py - regionY * CLIMATE_REGION_POINTS;
+                for (int px = pointX; px < endPointX; ++px)
+                {
+                    const int localX = firstPointX + px - regionX * CLIMATE_REGION_POINTS;
+                    if (!region->m_isSampled[localY][localX])
+                    {
+                        region->m_points[localY][localX] = m_biomeGen.SampleRawClimate(
+                            (firstPointX + px) * CLIMATE_GRID_SPACING, (firstPointY + py) * CLIMATE_GRID_SPACING);
+                        region->m_isSampled[localY][localX] = true;
+                        m_numGridSamples++;
+                    }
+                    grid[py][px] = region->m_points[localY][localX];
+                }
+            }
+            pointX = endPointX;
+        }
+        pointY = endPointY;
+    }
+
+    // 2. 双线性插值到每一列；峰谷在插值后再折叠
+    for (int y = 0; y < CHUNK_SIZE_Y; ++y)
+    {
+        const int cellY = y / CLIMATE_GRID_SPACING;
+        const float fractionY = (float)(y - cellY * CLIMATE_GRID_SPACING) / (float)CLIMATE_GRID_SPACING;
+        for (int x = 0; x < CHUNK_SIZE_X; ++x)
+        {
+            const int cellX = x / CLIMATE_GRID_SPACING;
+            const float fractionX = (float)(x - cellX * CLIMATE_GRID_SPACING) / (float)CLIMATE_GRID_SPACING;
+            BiomeGenerator::BiomeParameters const& southWest = grid[cellY][cellX];
+            BiomeGenerator::BiomeParameters const& southEast = grid[cellY][cellX + 1];
+            BiomeGenerator::BiomeParameters const& northWest = grid[cellY + 1][cellX];
+            BiomeGenerator::BiomeParameters const& northEast = grid[cellY + 1][cellX + 1];
+            auto blend = [&](float BiomeGenerator::BiomeParameters::* field)
+            {
+                float south = Interpolate(southWest.*field, southEast.*field, fractionX);
+                float north = Interpolate(northWest.*field, northEast.*field, fractionX);
+                return Interpolate(south, north, fractionY);
+            };
+
+            BiomeGenerator::BiomeParameters& params = outParams[x][y];
+            params.m_temperature = blend(&BiomeGenerator::BiomeParameters::m_temperature);
+            params.m_humidity = blend(&BiomeGenerator::BiomeParameters::m_humidity);
+            params.m_continentalness = blend(&BiomeGenerator::BiomeParameters::m_continentalness);
+            params.m_erosion = blend(&BiomeGenerator::BiomeParameters::m_erosion);
+            params.m_weirdness = blend(&BiomeGenerator::BiomeParameters::m_weirdness);
+            params.m_peaksAndValleys = BiomeGenerator::FoldPeaksAndValleys(blend(&BiomeGenerator::BiomeParameters::m_peaksAndValleys));
+        }
+    }
+    m_numSampledChunks++;
+}
@@ -0,0 +1,50 @@
+﻿#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include "BiomeGenerator.h"
+#include "Engine/Math/IntVec2.hpp"
+#include "Game/Gamecommon.hpp"
+
+// 六个气候场的尺度都在 512~1024 格，只在每 4 格一个的网格点上采样，列上的值双线性插值。
+// 网格点按区域（8x8 个 chunk）分块缓存，相邻 chunk 共用边上的网格点，每个点整个世界只算一次
+constexpr int CLIMATE_GRID_SPACING = 4;
+constexpr int CLIMATE_REGION_CHUNKS = 8;
+constexpr int CLIMATE_REGION_POINTS = CLIMATE_REGION_CHUNKS * CHUNK_SIZE_X / CLIMATE_GRID_SPACING;    // 每边 32 个网格点
+constexpr int CLIMATE_CHUNK_POINTS = CHUNK_SIZE_X / CLIMATE_GRID_SPACING + 1;                           // 一个 chunk 每边用到 5 个
+constexpr int CLIMATE_MAX_CACHED_REGIONS = 64;     // 约 1.5MB，远超激活范围
+static_assert(CHUNK_SIZE_X == CHUNK_SIZE_Y && CHUNK_SIZE_X % CLIMATE_GRID_SPACING == 0, "climate grid must tile a chunk");
+
+class ClimateSampler
+{
+public:
+    explicit ClimateSampler(BiomeGenerator& biomeGen);
+
+    // 一个 chunk 全部列的气候参数；可以在多个 worker 上同时调用
+    void SampleChunk(IntVec2 const& chunkCoords, BiomeGenerator::BiomeParameters outParams[CHUNK_SIZE_X][CHUNK_SIZE_Y]);
+    void Clear();
+
+    uint64_t GetNumGridSamples() const { return m_numGridSamples.load(); }    // 实际算过噪声的网格点
+    uint64_t GetNumSampledChunks() const { return m_numSampledChunks.load(); }
+    int GetNumCachedRegions() const;
+
+private:
+    struct ClimateRegion
+    {
+        std::mutex m_mutex;
+        BiomeGenerator::BiomeParameters m_points[CLIMATE_REGION_POINTS][CLIMATE_REGION_POINTS];    // [y][x]，原始噪声值
+        bool m_isSampled[CLIMATE_REGION_POINTS][CLIMATE_REGION_POINTS] = {};
+        uint64_t m_lastUsed = 0;
+    };
+
+    std::shared_ptr<ClimateRegion> AcquireRegion(IntVec2 const& regionCoords);
+
+    BiomeGenerator& m_biomeGen;
+    mutable std::mutex m_regionsMutex;
+    std::unordered_map<uint64_t, std::shared_ptr<ClimateRegion>> m_regions;
+    uint64_t m_useCounter = 0;
+    std::atomic<uint64_t> m_numGridSamples{0};
+    std::atomic<uint64_t> m_numSampledChunks{0};
+};
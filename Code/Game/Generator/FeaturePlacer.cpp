@@ -361,7 +361,7 @@ void FeaturePlacer::PlaceTree(Chunk* chunk, int localX, int localY, int surfaceZ
             z >= 0 && z < CHUNK_SIZE_Z)
         {
             int idx = LocalCoordsToIndex(x, y, z);
-            chunk->m_blocks[idx].SetType(stamp.m_logType);
+            chunk->m_buildBlocks[idx].SetType(stamp.m_logType);
         }
     }
     
@@ -378,11 +378,11 @@ void FeaturePlacer::PlaceTree(Chunk* chunk, int localX, int localY, int surfaceZ
                 z >= 0 && z < CHUNK_SIZE_Z)
             {
                 int idx = LocalCoordsToIndex(x, y, z);
-                uint8_t currentType = chunk->m_blocks[idx].m_typeIndex;
+                uint8_t currentType = chunk->m_buildBlocks[idx].m_typeIndex;
                 
                 if (currentType == BLOCK_TYPE_AIR || currentType == BLOCK_TYPE_SNOW)
                 {
-                    chunk->m_blocks[idx].SetType(stamp.m_leafType);
+                    chunk->m_buildBlocks[idx].SetType(stamp.m_leafType);
                 }
             }
         }
@@ -413,7 +413,7 @@ bool FeaturePlacer::CanPlaceTree(Chunk* chunk, int localX, int localY, int surfa
         if (!inside(x, y, z))
             return false; 
         int idx = LocalCoordsToIndex(x, y, z);
-        if (chunk->m_blocks[idx].m_typeIndex != BLOCK_TYPE_AIR) return false;
+        if (chunk->m_buildBlocks[idx].m_typeIndex != BLOCK_TYPE_AIR) return false;
     }
     
     for (const IntVec3& o : stamp.m_leafPositions)
@@ -423,7 +423,7 @@ bool FeaturePlacer::CanPlaceTree(Chunk* chunk, int localX, int localY, int surfa
         int z = surfaceZ + 1 + o.z;
         if (!inside(x, y, z)) return false; 
         int idx = LocalCoordsToIndex(x, y, z);
-        uint8_t t = chunk->m_blocks[idx].m_typeIndex;
+        uint8_t t = chunk->m_buildBlocks[idx].m_typeIndex;
         if (!(t == BLOCK_TYPE_AIR || t == BLOCK_TYPE_SNOW))
             return false;
     }
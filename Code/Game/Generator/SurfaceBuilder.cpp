@@ -6,7 +6,8 @@
 #include "ThirdParty/Noise/SmoothNoise.hpp"
 
 extern Game* g_theGame;
-SurfaceBuilder::SurfaceBuilder()
+SurfaceBuilder::SurfaceBuilder(WorldGenSettings const& settings)
+    : m_settings(settings)
 {
 }
 
@@ -271,7 +272,7 @@ void SurfaceBuilder::ApplyTemperatureOverrides(Block* blocks, float temperature)
         {
             for (int x = 0; x < CHUNK_SIZE_X; x++)
             {
-                for (int z = g_theGame->g_seaLevel + 2; z >= g_theGame->g_seaLevel - 2; z--)
+                for (int z = m_settings.m_seaLevel + 2; z >= m_settings.m_seaLevel - 2; z--)
                 {
                     int idx = LocalCoordsToIndex(x, y, z);
                     
@@ -293,31 +294,42 @@ void SurfaceBuilder::ApplyTemperatureOverrides(Block* blocks, float temperature)
     }
 }
 
-void SurfaceBuilder::GenerateOres(Block* blocks, const IntVec2& chunkCoords)
+void SurfaceBuilder::GenerateOres(Block* blocks, const IntVec2& chunkCoords, NoiseSimdLevel noiseLevel)
 {
+    // 每行先挑出石头，再一起算矿物噪声
+    int stoneX[CHUNK_SIZE_X];
+    float stoneWorldX[CHUNK_SIZE_X];
+    float oreNoiseRow[CHUNK_SIZE_X];
     for (int z = 2; z < CHUNK_SIZE_Z; z++)
     {
         for (int y = 0; y < CHUNK_SIZE_Y; y++)
         {
+            int numStones = 0;
             for (int x = 0; x < CHUNK_SIZE_X; x++)
             {
-                int idx = LocalCoordsToIndex(x, y, z);
-                
-                if (blocks[idx].m_typeIndex != BLOCK_TYPE_STONE)
+                if (blocks[LocalCoordsToIndex(x, y, z)].m_typeIndex != BLOCK_TYPE_STONE)
                     continue;
-                
-                int worldX = chunkCoords.x * CHUNK_SIZE_X + x;
-                int worldY = chunkCoords.y * CHUNK_SIZE_Y + y;
-                
-                float oreNoise = Compute3dPerlinNoise(
-                    (float)worldX, (float)worldY, (float)z,
-                    16.0f,  
-                    2,     
-                    0.5f,
-                    2.0f,
-                    false,
-                    m_oreSeed
-                );
+                stoneX[numStones] = x;
+                stoneWorldX[numStones] = (float)(chunkCoords.x * CHUNK_SIZE_X + x);
+                numStones++;
+            }
+            if (numStones == 0)
+                continue;
+            
+            int worldY = chunkCoords.y * CHUNK_SIZE_Y + y;
+            Compute3dPerlinNoiseRow(noiseLevel, stoneWorldX, (float)worldY, (float)z, numStones, oreNoiseRow,
+                16.0f,  
+                2,     
+                0.5f,
+                2.0f,
+                false,
+                m_oreSeed
+            );
+            
+            for (int i = 0; i < numStones; i++)
+            {
+                int idx = LocalCoordsToIndex(stoneX[i], y, z);
+                float oreNoise = oreNoiseRow[i];
                 
                 if (z <= 16 && oreNoise > 0.95f)
                 {
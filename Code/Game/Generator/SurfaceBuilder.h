@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include "BatchedNoise.h"
 #include "BiomeGenerator.h"
 #include "Game/Gamecommon.hpp"
 
@@ -18,7 +19,7 @@ public:
     };
 
 public:
-    SurfaceBuilder();
+    explicit SurfaceBuilder(WorldGenSettings const& settings);
     
     SurfaceConfig GetSurfaceConfig(BiomeGenerator::BiomeType biome, float temperature, float humidity);
     
@@ -27,8 +28,9 @@ public:
     
     void ApplyTemperatureOverrides(Block* blocks, float temperature);
     
-    void GenerateOres(Block* blocks, const IntVec2& chunkCoords);
+    void GenerateOres(Block* blocks, const IntVec2& chunkCoords, NoiseSimdLevel noiseLevel);
 
 private:
+    WorldGenSettings const& m_settings;   // 所在 WorldGenPipeline 的那一份
     unsigned int m_oreSeed = 12345;
 };
\ No newline at end of file
@@ -10,8 +10,9 @@
 
 extern Game* g_theGame;
 
-TerrainGenerator::TerrainGenerator(unsigned int baseSeed)
-    : m_biomeGenerator(baseSeed)
+TerrainGenerator::TerrainGenerator(unsigned int baseSeed, WorldGenSettings const& settings)
+    : m_biomeGenerator(baseSeed, settings)
+    , m_settings(settings)
 {
     m_densitySeed = baseSeed + 100;
     
@@ -27,7 +28,7 @@ TerrainGenerator::~TerrainGenerator()
 
 Curve1D* TerrainGenerator::CreateContinentHeightOffsetCurve()
 {
-    std::vector<Vec2> points = g_theGame->g_heightOffsetCurvePoints;
+    std::vector<Vec2> const& points = m_settings.m_heightOffsetCurvePoints;
     if (points.empty())
         return nullptr;
     
@@ -51,7 +52,7 @@ Curve1D* TerrainGenerator::CreateContinentHeightOffsetCurve()
 
 Curve1D* TerrainGenerator::CreateContinentSquashingCurve()
 {
-    std::vector<Vec2> points = g_theGame->g_heightScaleCurvePoints;
+    std::vector<Vec2> const& points = m_settings.m_heightScaleCurvePoints;
     if (points.empty())
         return nullptr;
     
@@ -84,52 +85,89 @@ float TerrainGenerator::GetZBias(float z)
 
     // float center = (float)CHUNK_SIZE_Z / 2.0f;  // 64
     // return (z - center) * (2.0f / (float)CHUNK_SIZE_Z);
-    return (z - g_theGame->g_terrainHeight) * g_theGame->g_biasPerZ;
+    return (z - m_settings.m_terrainHeight) * m_settings.m_biasPerZ;
 }
 
 float TerrainGenerator::Calculate3DDensity(
     const Vec3& worldPos, 
     const BiomeGenerator::BiomeParameters& biomeParams)
+{
+    float noiseValue = SampleDensityNoise(worldPos);
+    return ApplyColumnTerms(noiseValue, worldPos.z, ComputeColumnTerms(biomeParams));
+}
+
+float TerrainGenerator::SampleDensityNoise(const Vec3& worldPos)
 {
     float noiseValue = 0.f;
-    if (g_theGame->g_densityNoiseEnabled)
+    if (m_settings.m_densityNoiseEnabled)
     {
         noiseValue = Compute3dPerlinNoise(
         worldPos.x, worldPos.y, worldPos.z,
-        g_theGame->g_densityNoiseScale,  // Scale
-        g_theGame->g_densityNoiseOctaves,       // Octaves
+        m_settings.m_densityNoiseScale,  // Scale
+        m_settings.m_densityNoiseOctaves,       // Octaves
         0.5f,    // Persistence
         2.0f,    // Lacunarity
         true,    // Renormalize
         m_densitySeed
         );
     }
+    return noiseValue;
+}
 
+void TerrainGenerator::SampleDensityNoiseRow(NoiseSimdLevel noiseLevel, const float* worldX, float worldY, float worldZ, int count, float* outNoise)
+{
+    if (!m_settings.m_densityNoiseEnabled)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            outNoise[i] = 0.f;
+        }
+        return;
+    }
+    Compute3dPerlinNoiseRow(noiseLevel, worldX, worldY, worldZ, count, outNoise,
+        m_settings.m_densityNoiseScale,
+        m_settings.m_densityNoiseOctaves,
+        0.5f, 2.0f, true,
+        m_densitySeed);
+}
+
+TerrainGenerator::ColumnDensityTerms TerrainGenerator::ComputeColumnTerms(const BiomeGenerator::BiomeParameters& biomeParams)
+{
+    ColumnDensityTerms terms;
+    terms.m_heightOffset = m_continentHeightOffsetCurve->Evaluate(biomeParams.m_continentalness);
+    terms.m_squash = m_continentSquashingCurve->Evaluate(biomeParams.m_continentalness);
+    
+    float default_terrain_height = m_settings.m_terrainReferenceHeight;
+    terms.m_baseHeight = default_terrain_height + (terms.m_heightOffset * m_settings.m_terrainHeight);
+    return terms;
+}
+
+// 运算顺序和拆分前的 Calculate3DDensity 一致，逐格精确模式的结果逐位不变
+float TerrainGenerator::ApplyColumnTerms(float noiseValue, float worldZ, const ColumnDensityTerms& terms)
+{
     float density = noiseValue;
-    if (g_theGame->g_densityNoiseBiasEnabled)
+    if (m_settings.m_densityNoiseBiasEnabled)
     {
-        float zBias = GetZBias(worldPos.z);
+        float zBias = GetZBias(worldZ);
         density += zBias;
     }
     
-    float h = m_continentHeightOffsetCurve->Evaluate(biomeParams.m_continentalness);
-    float s = m_continentSquashingCurve->Evaluate(biomeParams.m_continentalness);
-    
-    float default_terrain_height = g_theGame->g_terrainReferenceHeight;
-    float b = default_terrain_height + (h * g_theGame->g_terrainHeight);
-    float t = (worldPos.z - b) / b;
+    float h = terms.m_heightOffset;
+    float s = terms.m_squash;
+    float b = terms.m_baseHeight;
+    float t = (worldZ - b) / b;
 
-    if (g_theGame->g_continentHeightOffsetEnabled)
+    if (m_settings.m_continentHeightOffsetEnabled)
     {
         density -= h;        // Height offset
     }
-    if (g_theGame->g_continentHeightScaleEnabled)
+    if (m_settings.m_continentHeightScaleEnabled)
     {
         density += s * t;    // Squashing
 
-        if (worldPos.z < g_theGame->g_seaLevel - 10)
+        if (worldZ < m_settings.m_seaLevel - 10)
         {
-            float depthBelowSea = (g_theGame->g_seaLevel - 10) - worldPos.z;
+            float depthBelowSea = (m_settings.m_seaLevel - 10) - worldZ;
             float depthFactor = depthBelowSea * 0.02f;
             density -= depthFactor;
         }
@@ -154,6 +192,76 @@ float TerrainGenerator::Calculate3DDensity(
     return density;
 }
 
+TerrainGenerator::ColumnDensityBounds TerrainGenerator::ComputeColumnBounds(const ColumnDensityTerms& terms, int minZ, int maxZ)
+{
+    ColumnDensityBounds bounds;
+    bounds.m_minNoiseZ = minZ;
+    bounds.m_maxNoiseZ = maxZ;
+    
+    float h = terms.m_heightOffset;
+    float s = terms.m_squash;
+    float b = terms.m_baseHeight;
+    if (fabsf(b) < 1.0f)
+    {
+        // t = (z - b) / b 在 b 接近 0 时数值上不可靠，这一列不设界
+        return bounds;
+    }
+    
+    // 把 ApplyColumnTerms 里噪声以外的项按 z 展开成一次式，开关一一对应
+    float slope = 0.f;
+    float intercept = 0.f;
+    float kinkZ = -FLT_MAX;     // 海底加深项关掉时只有一段
+    float depthSlope = 0.f;
+    if (m_settings.m_densityNoiseBiasEnabled)
+    {
+        slope += m_settings.m_biasPerZ;
+        intercept -= m_settings.m_terrainHeight * m_settings.m_biasPerZ;
+    }
+    if (m_settings.m_continentHeightOffsetEnabled)
+    {
+        intercept -= h;
+    }
+    if (m_settings.m_continentHeightScaleEnabled)
+    {
+        slope += s / b;
+        intercept -= s;
+        kinkZ = (float)(m_settings.m_seaLevel - 10);
+        depthSlope = 0.02f;     // -(kinkZ - z) * 0.02
+    }
+    bounds.m_slopeAbove = slope;
+    bounds.m_interceptAbove = intercept;
+    bounds.m_slopeBelow = slope + depthSlope;
+    bounds.m_interceptBelow = intercept - depthSlope * (kinkZ > -FLT_MAX ? kinkZ : 0.f);
+    bounds.m_kinkZ = kinkZ;
+    
+    // 归一化的 Perlin 经过 SmoothStep3 重映射后在 [-1, 1] 里：单个八度是单位梯度的 Perlin 乘 1.5，
+    // 绝对值不超过 1.5 * sqrt(3) / 2 ≈ 1.3，按总振幅归一化后仍是这个界，映到 t = 0.5n + 0.5 落在 [-0.15, 1.15]；
+    // SmoothStep3(t) = 3t² - 2t³ 在 t = 0、1 取极值，端点 t = -0.5 时为 1、t = 1.5 时为 0，
+    // 所以把 [-0.5, 1.5] 映进 [0, 1]，再乘 2 减 1 就回到 [-1, 1]。粗格点插值是凸组合也不会越界。
+    // 余量再按各项绝对值之和放大一点，盖住 ApplyColumnTerms 和这里运算顺序不同带来的舍入差
+    float maxNoise = m_settings.m_densityNoiseEnabled ? 1.0f : 0.f;
+    float absZ = (float)MaxI(abs(minZ), abs(maxZ));
+    float termMagnitude = 1.0f
+        + fabsf(m_settings.m_biasPerZ) * (absZ + fabsf(m_settings.m_terrainHeight))
+        + fabsf(h)
+        + fabsf(s) * (absZ / fabsf(b) + 1.0f)
+        + depthSlope * (fabsf((float)m_settings.m_seaLevel) + 10.0f + absZ);
+    bounds.m_margin = maxNoise + 1.0e-5f * termMagnitude;
+    
+    bounds.m_minNoiseZ = maxZ + 1;
+    bounds.m_maxNoiseZ = minZ - 1;
+    for (int z = minZ; z <= maxZ; z++)
+    {
+        if (bounds.Classify((float)z) == DENSITY_BOUND_NEEDS_NOISE)
+        {
+            if (z < bounds.m_minNoiseZ)
+                bounds.m_minNoiseZ = z;
+            bounds.m_maxNoiseZ = z;
+        }
+    }
+    return bounds;
+}
+
 float TerrainGenerator::FoldDensity(float density, float threshold, float strength)
 {
     if (density > threshold)
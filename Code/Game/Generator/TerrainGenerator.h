@@ -1,19 +1,67 @@
 ﻿#pragma once
+#include <cfloat>
 
+#include "BatchedNoise.h"
 #include "BiomeGenerator.h"
 #include "Engine/Math/Vec3.hpp"
+#include "Game/Gamecommon.hpp"
 
 class Curve1D;
 
 class TerrainGenerator
 {
 public:
-    TerrainGenerator(unsigned int baseSeed);
+    TerrainGenerator(unsigned int baseSeed, WorldGenSettings const& settings);
     ~TerrainGenerator();
     
+    // 密度 = 只随世界坐标变的 3D 噪声 + 只随列（大陆度）和 z 变的偏置项。
+    // 粗格点模式只对前者插值，后者每列算一次后逐格精确叠加
+    struct ColumnDensityTerms
+    {
+        float m_heightOffset = 0.f;    // h，高度偏移曲线
+        float m_squash = 0.f;          // s，挤压曲线
+        float m_baseHeight = 0.f;      // b，这一列的参考地表高度
+    };
+
+    // 去掉噪声后一列的密度对 z 是两段线性的（折点在海平面下 10 格），归一化噪声又在 [-1, 1] 里，
+    // 所以每格密度有保守的上下界：上界 < 0 必是石头，下界 >= 0 必是空气，只有夹在中间的格子才要真的算密度。
+    // ApplyColumnTerms 对噪声单调不减，界外的格子和完整计算的结果逐位相同
+    enum DensityBoundResult : unsigned char
+    {
+        DENSITY_BOUND_SOLID,
+        DENSITY_BOUND_AIR,
+        DENSITY_BOUND_NEEDS_NOISE
+    };
+    struct ColumnDensityBounds
+    {
+        float m_slopeAbove = 0.f;          // z >= m_kinkZ：噪声以外的项 = slope * z + intercept
+        float m_interceptAbove = 0.f;
+        float m_slopeBelow = 0.f;          // z < m_kinkZ：多了海底加深项
+        float m_interceptBelow = 0.f;
+        float m_kinkZ = 0.f;
+        float m_margin = FLT_MAX;          // 噪声最大幅度 + 浮点舍入余量；默认值表示不设界，每格都要算
+        int m_minNoiseZ = 0;               // 需要算密度的 z 闭区间（包住所有夹在中间的格子），没有时 min > max
+        int m_maxNoiseZ = CHUNK_SIZE_Z - 1;
+
+        DensityBoundResult Classify(float worldZ) const
+        {
+            float offset = worldZ < m_kinkZ ? m_slopeBelow * worldZ + m_interceptBelow : m_slopeAbove * worldZ + m_interceptAbove;
+            if (offset + m_margin < 0.f)
+                return DENSITY_BOUND_SOLID;
+            if (offset - m_margin >= 0.f)
+                return DENSITY_BOUND_AIR;
+            return DENSITY_BOUND_NEEDS_NOISE;
+        }
+    };
+
     float Calculate3DDensity(
         const Vec3& worldPos, 
         const BiomeGenerator::BiomeParameters& biomeParams);
+    float SampleDensityNoise(const Vec3& worldPos);
+    void SampleDensityNoiseRow(NoiseSimdLevel noiseLevel, const float* worldX, float worldY, float worldZ, int count, float* outNoise);
+    ColumnDensityTerms ComputeColumnTerms(const BiomeGenerator::BiomeParameters& biomeParams);
+    float ApplyColumnTerms(float noiseValue, float worldZ, const ColumnDensityTerms& terms);
+    ColumnDensityBounds ComputeColumnBounds(const ColumnDensityTerms& terms, int minZ, int maxZ);
     
     float FoldDensity(float density, float threshold, float strength);
     int GetSurfaceHeight(int worldX, int worldY, const BiomeGenerator::BiomeParameters& biomeParams);
@@ -22,6 +70,7 @@ public:
 
 private:
     BiomeGenerator m_biomeGenerator;
+    WorldGenSettings const& m_settings;   // 所在 WorldGenPipeline 的那一份
     unsigned int m_densitySeed;
     
     Curve1D* m_continentHeightOffsetCurve;   
@@ -3,41 +3,105 @@
 #include "Game/Chunk.h"
 #include "Game/ChunkUtils.h"
 #include "Game/Game.hpp"
+#include "Engine/Core/Time.hpp"
+#include "Engine/Math/MathUtils.hpp"
 
 extern Game* g_theGame;
 
-WorldGenPipeline::WorldGenPipeline()
-    : m_biomeGen(BiomeGenerator(GAME_SEED))
-    , m_terrainGen(TerrainGenerator(GAME_SEED))
-    , m_caveGen(CaveGenerator(GAME_SEED))
+WorldGenPipeline::WorldGenPipeline(WorldGenSettings const& settings)
+    : m_settings(settings)
+    , m_biomeGen(GAME_SEED, m_settings)
+    , m_terrainGen(GAME_SEED, m_settings)
+    , m_caveGen(GAME_SEED, m_settings)
+    , m_surfaceBuilder(m_settings)
     , m_featurePlacer(FeaturePlacer(GAME_SEED))
-    , m_surfaceBuilder(SurfaceBuilder())
+    , m_climateSampler(m_biomeGen)
 {
 }
 
-void WorldGenPipeline::GenerateChunk(Chunk* chunk)
+WorldGenOptions WorldGenOptions::FromGameSettings()
+{
+    WorldGenOptions options;
+    options.m_useCoarseDensity = g_theGame->g_useCoarseDensity;
+    options.m_noiseSimdLevel = g_theGame->g_useSimdNoise ? GetSupportedNoiseSimdLevel() : NoiseSimdLevel::SCALAR;
+    options.m_useClimateGrid = g_theGame->g_useClimateGrid;
+    options.m_useDensityBounds = g_theGame->g_useDensityBounds;
+    options.m_useCoarseCaveNoise = g_theGame->g_useCoarseCaveNoise;
+    return options;
+}
+
+template <typename T>
+static void HashGeneratorValue(uint32_t& hash, T const& value)
+{
+    unsigned char const* bytes = reinterpret_cast<unsigned char const*>(&value);
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+}
+
+uint32_t WorldGenOptions::ComputeGeneratorHash(WorldGenSettings const& settings) const
+{
+    // FNV-1a；覆盖的参数和 WorldGen.dat 里存的完全一致，同一个世界重开结果不变。
+    // SIMD 级别不算在内：各级别逐位相同，同一份存档换台 CPU 也能用
+    uint32_t hash = 2166136261u;
+    HashGeneratorValue(hash, GAME_SEED);
+    HashGeneratorValue(hash, m_useCoarseDensity);
+    HashGeneratorValue(hash, m_useClimateGrid);
+    HashGeneratorValue(hash, m_useDensityBounds);
+    HashGeneratorValue(hash, m_useCoarseCaveNoise);
+    return settings.AccumulateHash(hash);
+}
+
+void WorldGenPipeline::GenerateChunk(Chunk* chunk, const WorldGenOptions& options, WorldGenTimings* outTimings)
 {
     ChunkGenData chunkGenData = ChunkGenData();
+    double stageStartTime = outTimings ? GetCurrentTimeSeconds() : 0.0;
     
-    ExecuteBiomeStage(chunk, &chunkGenData);
-    ExecuteNoiseStage(chunk, &chunkGenData);
-    if (g_theGame->g_caveCarvingEnabled)
+    ExecuteBiomeStage(chunk, &chunkGenData, options);
+    if (outTimings)
+    {
+        double now = GetCurrentTimeSeconds();
+        outTimings->m_biomeSeconds += now - stageStartTime;
+        stageStartTime = now;
+    }
+    ExecuteNoiseStage(chunk, &chunkGenData, options);
+    if (outTimings)
+    {
+        double now = GetCurrentTimeSeconds();
+        outTimings->m_noiseSeconds += now - stageStartTime;
+        stageStartTime = now;
+    }
+    if (m_settings.m_caveCarvingEnabled)
     {
-        ExecuteCaveStage(chunk, &chunkGenData);
+        ExecuteCaveStage(chunk, &chunkGenData, options);
     }
-    if (g_theGame->g_seaEnabled)
+    if (outTimings)
+    {
+        double now = GetCurrentTimeSeconds();
+        outTimings->m_caveSeconds += now - stageStartTime;
+        stageStartTime = now;
+    }
+    // 之后的阶段从高度图给出的列顶往下找，不再从 CHUNK_SIZE_Z 开始扫
+    chunk->RebuildHeightMap();
+    if (m_settings.m_seaEnabled)
     {
         ExecuteWaterStage(chunk, &chunkGenData);
     }
-    if (g_theGame->g_blockReplacementEnabled)
+    if (m_settings.m_blockReplacementEnabled)
     {
-        ExecuteSurfaceStage(chunk, &chunkGenData);
+        ExecuteSurfaceStage(chunk, &chunkGenData, options);
     }
-    if (g_theGame->g_treeGenerationEnabled)
+    if (m_settings.m_treeGenerationEnabled)
     {
         ExecuteFeatureStage(chunk, &chunkGenData);
     }
     //ExecuteCarverStage(chunk, &chunkGenData);
+    if (outTimings)
+    {
+        outTimings->m_finishSeconds += GetCurrentTimeSeconds() - stageStartTime;
+        outTimings->m_numChunks++;
+    }
 
     chunk->m_chunkGenData = chunkGenData;
     
@@ -45,9 +109,17 @@ void WorldGenPipeline::GenerateChunk(Chunk* chunk)
     //chunkGenData = nullptr;
 }
 
-void WorldGenPipeline::ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenData)
+void WorldGenPipeline::ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options)
 {
-    IntVec2 chunkCoords = chunk->GetThisChunkCoords();
+    SampleChunkBiomes(chunk->GetThisChunkCoords(), chunkGenData, options);
+}
+
+void WorldGenPipeline::SampleChunkBiomes(IntVec2 chunkCoords, ChunkGenData* chunkGenData, const WorldGenOptions& options)
+{
+    if (options.m_useClimateGrid)
+    {
+        m_climateSampler.SampleChunk(chunkCoords, chunkGenData->m_biomeParams);
+    }
     
     for (int y = 0; y < CHUNK_SIZE_Y; y++)
     {
@@ -56,7 +128,10 @@ void WorldGenPipeline::ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenDat
             int worldX = chunkCoords.x * CHUNK_SIZE_X + x;
             int worldY = chunkCoords.y * CHUNK_SIZE_Y + y;
             
-            chunkGenData->m_biomeParams[x][y] = m_biomeGen.SampleBiomeParameters(worldX, worldY);
+            if (!options.m_useClimateGrid)
+            {
+                chunkGenData->m_biomeParams[x][y] = m_biomeGen.SampleBiomeParameters(worldX, worldY);
+            }
             chunkGenData->m_biomes[x][y] = m_biomeGen.DetermineBiome(chunkGenData->m_biomeParams[x][y]);
             //chunkGenData->m_surfaceHeights[x][y] = 
              //   m_terrainGen.GetSurfaceHeight(worldX, worldY, chunkGenData->m_biomeParams[x][y]);
@@ -65,49 +140,283 @@ void WorldGenPipeline::ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenDat
     }
 }
 
-void WorldGenPipeline::ExecuteNoiseStage(Chunk* chunk, ChunkGenData* chunkGenData)
+void WorldGenPipeline::ExecuteNoiseStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options)
 {
-    IntVec2 chunkCoords = chunk->GetThisChunkCoords();
+    FillChunkDensity(chunk->GetThisChunkCoords(), chunkGenData, chunk->m_buildBlocks, options);
+}
+
+int WorldGenPipeline::FillChunkDensity(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options)
+{
+    if (options.m_useCoarseDensity)
+    {
+        return FillDensityCoarse(chunkCoords, chunkGenData, outBlocks, options);
+    }
+    return FillDensityExact(chunkCoords, chunkGenData, outBlocks, options);
+}
+
+void WorldGenPipeline::ComputeChunkDensityBounds(ChunkGenData* chunkGenData, const WorldGenOptions& options,
+    TerrainGenerator::ColumnDensityTerms outTerms[CHUNK_SIZE_X][CHUNK_SIZE_Y],
+    TerrainGenerator::ColumnDensityBounds outBounds[CHUNK_SIZE_X][CHUNK_SIZE_Y])
+{
+    // 曲线项只和列有关，每列算一次；关掉上下界时 outBounds 保持默认值（每格都要算）
+    for (int y = 0; y < CHUNK_SIZE_Y; y++)
+    {
+        for (int x = 0; x < CHUNK_SIZE_X; x++)
+        {
+            outTerms[x][y] = m_terrainGen.ComputeColumnTerms(chunkGenData->m_biomeParams[x][y]);
+            outBounds[x][y] = TerrainGenerator::ColumnDensityBounds();
+            if (options.m_useDensityBounds)
+            {
+                outBounds[x][y] = m_terrainGen.ComputeColumnBounds(outTerms[x][y], 2, CHUNK_SIZE_Z - 1);
+            }
+        }
+    }
+}
+
+int WorldGenPipeline::FillDensityExact(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options)
+{
+    // 逐格采样噪声（标量噪声时结果和逐格调 Calculate3DDensity 逐位相同）
+    TerrainGenerator::ColumnDensityTerms columnTerms[CHUNK_SIZE_X][CHUNK_SIZE_Y];
+    TerrainGenerator::ColumnDensityBounds columnBounds[CHUNK_SIZE_X][CHUNK_SIZE_Y];
+    ComputeChunkDensityBounds(chunkGenData, options, columnTerms, columnBounds);
+    
+    // 同一 y、z 的一行 x 里，只把落在地表带里的格子收集起来一起算噪声
+    int rowLocalX[CHUNK_SIZE_X];
+    float rowWorldX[CHUNK_SIZE_X];
+    float rowNoise[CHUNK_SIZE_X];
+    int numEvaluated = 0;
     
     for (int z = 0; z < CHUNK_SIZE_Z; z++)
     {
         for (int y = 0; y < CHUNK_SIZE_Y; y++)
         {
+            if (z <= 1)
+            {
+                for (int x = 0; x < CHUNK_SIZE_X; x++)
+                {
+                    outBlocks[LocalCoordsToIndex(x, y, z)].SetType(BLOCK_TYPE_OBSIDIAN);
+                }
+                continue;
+            }
+            
+            float worldY = (float)(chunkCoords.y * CHUNK_SIZE_Y + y);
+            float worldZ = (float)z;
+            int count = 0;
             for (int x = 0; x < CHUNK_SIZE_X; x++)
             {
+                TerrainGenerator::DensityBoundResult bound = columnBounds[x][y].Classify(worldZ);
+                if (bound == TerrainGenerator::DENSITY_BOUND_SOLID)
+                {
+                    outBlocks[LocalCoordsToIndex(x, y, z)].SetType(BLOCK_TYPE_STONE);
+                    chunkGenData->m_surfaceHeights[x][y] = z;
+                }
+                else if (bound == TerrainGenerator::DENSITY_BOUND_AIR)
+                {
+                    outBlocks[LocalCoordsToIndex(x, y, z)].SetType(BLOCK_TYPE_AIR);
+                }
+                else
+                {
+                    rowLocalX[count] = x;
+                    rowWorldX[count] = (float)(chunkCoords.x * CHUNK_SIZE_X + x);
+                    count++;
+                }
+            }
+            if (count == 0)
+                continue;
+            
+            m_terrainGen.SampleDensityNoiseRow(options.m_noiseSimdLevel, rowWorldX, worldY, worldZ, count, rowNoise);
+            numEvaluated += count;
+            
+            for (int i = 0; i < count; i++)
+            {
+                int x = rowLocalX[i];
                 int idx = LocalCoordsToIndex(x, y , z);
+                float density = m_terrainGen.ApplyColumnTerms(rowNoise[i], worldZ, columnTerms[x][y]);
                 
-                if (z <= 1)
+                if (density < 0.0f)
+                {
+                    outBlocks[idx].SetType(BLOCK_TYPE_STONE);
+                    chunkGenData->m_surfaceHeights[x][y] = z;
+                }
+                else
+                {
+                    outBlocks[idx].SetType(BLOCK_TYPE_AIR);
+                }
+            }
+        }
+    }
+    return numEvaluated;
+}
+
+int WorldGenPipeline::FillDensityCoarse(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options)
+{
+    // 噪声只在粗格点上算（5x5x17 = 425 次，逐格是 32768 次），格内三线性插值。
+    // 曲线/Z 偏置/海底加深这些项对 z 是分段线性的、又只和列有关，插值反而会把折点抹平，所以逐格精确叠加
+    const int baseWorldX = chunkCoords.x * CHUNK_SIZE_X;
+    const int baseWorldY = chunkCoords.y * CHUNK_SIZE_Y;
+    
+    TerrainGenerator::ColumnDensityTerms columnTerms[CHUNK_SIZE_X][CHUNK_SIZE_Y];
+    TerrainGenerator::ColumnDensityBounds columnBounds[CHUNK_SIZE_X][CHUNK_SIZE_Y];
+    ComputeChunkDensityBounds(chunkGenData, options, columnTerms, columnBounds);
+    
+    // 每个格点只在相邻格子里有需要算密度的方块时才采样：先求每个格子的地表带，再摊到四个角上的 k 范围
+    int pointMinK[DENSITY_LATTICE_SIZE_Y][DENSITY_LATTICE_SIZE_X];
+    int pointMaxK[DENSITY_LATTICE_SIZE_Y][DENSITY_LATTICE_SIZE_X];
+    for (int j = 0; j < DENSITY_LATTICE_SIZE_Y; j++)
+    {
+        for (int i = 0; i < DENSITY_LATTICE_SIZE_X; i++)
+        {
+            pointMinK[j][i] = DENSITY_LATTICE_SIZE_Z;
+            pointMaxK[j][i] = -1;
+        }
+    }
+    int chunkMinNoiseZ = CHUNK_SIZE_Z;
+    int chunkMaxNoiseZ = -1;
+    for (int cellJ = 0; cellJ < DENSITY_LATTICE_SIZE_Y - 1; cellJ++)
+    {
+        for (int cellI = 0; cellI < DENSITY_LATTICE_SIZE_X - 1; cellI++)
+        {
+            int cellMinZ = CHUNK_SIZE_Z;
+            int cellMaxZ = -1;
+            for (int y = cellJ * DENSITY_CELL_SIZE_XY; y < (cellJ + 1) * DENSITY_CELL_SIZE_XY; y++)
+            {
+                for (int x = cellI * DENSITY_CELL_SIZE_XY; x < (cellI + 1) * DENSITY_CELL_SIZE_XY; x++)
+                {
+                    const TerrainGenerator::ColumnDensityBounds& bounds = columnBounds[x][y];
+                    if (bounds.m_minNoiseZ > bounds.m_maxNoiseZ)
+                        continue;
+                    cellMinZ = MinI(cellMinZ, bounds.m_minNoiseZ);
+                    cellMaxZ = MaxI(cellMaxZ, bounds.m_maxNoiseZ);
+                }
+            }
+            if (cellMinZ > cellMaxZ)
+                continue;
+            chunkMinNoiseZ = MinI(chunkMinNoiseZ, cellMinZ);
+            chunkMaxNoiseZ = MaxI(chunkMaxNoiseZ, cellMaxZ);
+            
+            // z 落在 [k*8, k*8+7] 的方块用第 k 和 k+1 层格点
+            int minK = cellMinZ / DENSITY_CELL_SIZE_Z;
+            int maxK = cellMaxZ / DENSITY_CELL_SIZE_Z + 1;
+            for (int j = cellJ; j <= cellJ + 1; j++)
+            {
+                for (int i = cellI; i <= cellI + 1; i++)
+                {
+                    pointMinK[j][i] = MinI(pointMinK[j][i], minK);
+                    pointMaxK[j][i] = MaxI(pointMaxK[j][i], maxK);
+                }
+            }
+        }
+    }
+    
+    int rowLatticeI[DENSITY_LATTICE_SIZE_X];
+    float rowWorldX[DENSITY_LATTICE_SIZE_X];
+    float rowNoise[DENSITY_LATTICE_SIZE_X];
+    float lattice[DENSITY_LATTICE_SIZE_Z][DENSITY_LATTICE_SIZE_Y][DENSITY_LATTICE_SIZE_X];
+    for (int k = 0; k < DENSITY_LATTICE_SIZE_Z; k++)
+    {
+        for (int j = 0; j < DENSITY_LATTICE_SIZE_Y; j++)
+        {
+            int count = 0;
+            for (int i = 0; i < DENSITY_LATTICE_SIZE_X; i++)
+            {
+                if (k >= pointMinK[j][i] && k <= pointMaxK[j][i])
+                {
+                    rowLatticeI[count] = i;
+                    rowWorldX[count] = (float)(baseWorldX + i * DENSITY_CELL_SIZE_XY);
+                    count++;
+                }
+            }
+            if (count == 0)
+                continue;
+            m_terrainGen.SampleDensityNoiseRow(options.m_noiseSimdLevel, rowWorldX,
+                (float)(baseWorldY + j * DENSITY_CELL_SIZE_XY), (float)(k * DENSITY_CELL_SIZE_Z),
+                count, rowNoise);
+            for (int n = 0; n < count; n++)
+            {
+                lattice[k][j][rowLatticeI[n]] = rowNoise[n];
+            }
+        }
+    }
+    
+    // 先沿 z 插出当前层的 5x5 平面，再在平面上做双线性
+    float layer[DENSITY_LATTICE_SIZE_Y][DENSITY_LATTICE_SIZE_X];
+    int numEvaluated = 0;
+    for (int z = 0; z < CHUNK_SIZE_Z; z++)
+    {
+        if (z <= 1)
+        {
+            for (int y = 0; y < CHUNK_SIZE_Y; y++)
+            {
+                for (int x = 0; x < CHUNK_SIZE_X; x++)
+                {
+                    outBlocks[LocalCoordsToIndex(x, y, z)].SetType(BLOCK_TYPE_OBSIDIAN);
+                }
+            }
+            continue;
+        }
+        
+        int k = z / DENSITY_CELL_SIZE_Z;
+        float tz = (float)(z - k * DENSITY_CELL_SIZE_Z) / (float)DENSITY_CELL_SIZE_Z;
+        if (z >= chunkMinNoiseZ && z <= chunkMaxNoiseZ)
+        {
+            for (int j = 0; j < DENSITY_LATTICE_SIZE_Y; j++)
+            {
+                for (int i = 0; i < DENSITY_LATTICE_SIZE_X; i++)
+                {
+                    if (k >= pointMinK[j][i] && k + 1 <= pointMaxK[j][i])
+                    {
+                        layer[j][i] = Interpolate(lattice[k][j][i], lattice[k + 1][j][i], tz);
+                    }
+                }
+            }
+        }
+        
+        float worldZ = (float)z;
+        for (int y = 0; y < CHUNK_SIZE_Y; y++)
+        {
+            int j = y / DENSITY_CELL_SIZE_XY;
+            float ty = (float)(y - j * DENSITY_CELL_SIZE_XY) / (float)DENSITY_CELL_SIZE_XY;
+            for (int x = 0; x < CHUNK_SIZE_X; x++)
+            {
+                int idx = LocalCoordsToIndex(x, y, z);
+                TerrainGenerator::DensityBoundResult bound = columnBounds[x][y].Classify(worldZ);
+                if (bound == TerrainGenerator::DENSITY_BOUND_SOLID)
                 {
-                    //chunk->m_blocks[idx].SetType(BLOCK_TYPE_OBSIDIAN);
-                    chunk->m_blocks[idx].SetType(BLOCK_TYPE_OBSIDIAN);
+                    outBlocks[idx].SetType(BLOCK_TYPE_STONE);
+                    chunkGenData->m_surfaceHeights[x][y] = z;
+                    continue;
+                }
+                if (bound == TerrainGenerator::DENSITY_BOUND_AIR)
+                {
+                    outBlocks[idx].SetType(BLOCK_TYPE_AIR);
                     continue;
                 }
                 
-                float worldX = (float)(chunkCoords.x * CHUNK_SIZE_X + x);
-                float worldY = (float)(chunkCoords.y * CHUNK_SIZE_Y + y);
-                float worldZ = (float)z;
-                
-                Vec3 worldPos(worldX, worldY, worldZ);
+                int i = x / DENSITY_CELL_SIZE_XY;
+                float tx = (float)(x - i * DENSITY_CELL_SIZE_XY) / (float)DENSITY_CELL_SIZE_XY;
                 
-                BiomeGenerator::BiomeParameters biomeParams = chunkGenData->m_biomeParams[x][y];
-                float density = m_terrainGen.Calculate3DDensity(worldPos, biomeParams);
+                float south = Interpolate(layer[j][i], layer[j][i + 1], tx);
+                float north = Interpolate(layer[j + 1][i], layer[j + 1][i + 1], tx);
+                float noiseValue = Interpolate(south, north, ty);
+                float density = m_terrainGen.ApplyColumnTerms(noiseValue, worldZ, columnTerms[x][y]);
+                numEvaluated++;
                 
                 if (density < 0.0f)
                 {
-                    chunk->m_blocks[idx].SetType(BLOCK_TYPE_STONE);
+                    outBlocks[idx].SetType(BLOCK_TYPE_STONE);
                     chunkGenData->m_surfaceHeights[x][y] = z;
                 }
                 else
                 {
-                    chunk->m_blocks[idx].SetType(BLOCK_TYPE_AIR);
+                    outBlocks[idx].SetType(BLOCK_TYPE_AIR);
                 }
             }
         }
     }
+    return numEvaluated;
 }
 
-void WorldGenPipeline::ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenData)
+void WorldGenPipeline::ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options)
 {
     for (int y = 0; y < CHUNK_SIZE_Y; y++)
     {
@@ -121,12 +430,13 @@ void WorldGenPipeline::ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenD
                 m_surfaceBuilder.GetSurfaceConfig(biome, temperature, humidity);
             
             int surfaceZ = -1;
-            for (int z = CHUNK_SIZE_Z - 2; z >= 2; --z)
+            int topZ = chunk->GetColumnHeight(x, y) < CHUNK_SIZE_Z - 2 ? chunk->GetColumnHeight(x, y) : CHUNK_SIZE_Z - 2;
+            for (int z = topZ; z >= 2; --z)
             {
                 int idx = LocalCoordsToIndex(x, y, z);
                 int idxUp = LocalCoordsToIndex(x, y, z + 1);
-                uint8_t t = chunk->m_blocks[idx].m_typeIndex;
-                uint8_t tUp = chunk->m_blocks[idxUp].m_typeIndex;
+                uint8_t t = chunk->m_buildBlocks[idx].m_typeIndex;
+                uint8_t tUp = chunk->m_buildBlocks[idxUp].m_typeIndex;
 
                 if (IsSolid(t) && IsNonGroundCover(tUp))
                 {
@@ -137,7 +447,7 @@ void WorldGenPipeline::ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenD
 
             if (surfaceZ >= 2)
             {
-                m_surfaceBuilder.BuildSurface(chunk->m_blocks, x, y, surfaceZ, config);
+                m_surfaceBuilder.BuildSurface(chunk->m_buildBlocks, x, y, surfaceZ, config);
             }
         }
     }
@@ -153,14 +463,22 @@ void WorldGenPipeline::ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenD
     }
     avgTemperature /= (CHUNK_SIZE_X * CHUNK_SIZE_Y);
     
-    m_surfaceBuilder.ApplyTemperatureOverrides(chunk->m_blocks, avgTemperature);
+    m_surfaceBuilder.ApplyTemperatureOverrides(chunk->m_buildBlocks, avgTemperature);
     
-    m_surfaceBuilder.GenerateOres(chunk->m_blocks, chunk->GetThisChunkCoords());
+    m_surfaceBuilder.GenerateOres(chunk->m_buildBlocks, chunk->GetThisChunkCoords(), options.m_noiseSimdLevel);
 }
 
-void WorldGenPipeline::ExecuteCaveStage(Chunk* chunk, ChunkGenData* chunkGenData)
+void WorldGenPipeline::ExecuteCaveStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options)
 {
-    m_caveGen.CarveCaves(chunk->m_blocks, chunk->GetThisChunkCoords(), *chunkGenData);
+    CaveCarveOptions caveOptions;
+    caveOptions.m_noiseLevel = options.m_noiseSimdLevel;
+    caveOptions.m_useCoarseNoise = options.m_useCoarseCaveNoise;
+    CarveChunkCaves(chunk->GetThisChunkCoords(), *chunkGenData, chunk->m_buildBlocks, caveOptions);
+}
+
+void WorldGenPipeline::CarveChunkCaves(IntVec2 chunkCoords, const ChunkGenData& chunkGenData, Block* blocks, const CaveCarveOptions& options)
+{
+    m_caveGen.CarveCaves(blocks, chunkCoords, chunkGenData, options);
 }
 
 void WorldGenPipeline::ExecuteWaterStage(Chunk* chunk, ChunkGenData* chunkGenData)
@@ -170,31 +488,22 @@ void WorldGenPipeline::ExecuteWaterStage(Chunk* chunk, ChunkGenData* chunkGenDat
     {
         for (int x = 0; x < CHUNK_SIZE_X; x++)
         {
-            int firstSolidZ = -1;
-            for (int z = CHUNK_SIZE_Z - 1; z >= 2; --z)
-            {
-                int idx = LocalCoordsToIndex(x, y, z);
-                uint8_t blockType = chunk->m_blocks[idx].m_typeIndex;
-                
-                if (blockType != BLOCK_TYPE_AIR)
-                {
-                    firstSolidZ = z;
-                    break;
-                }
-            }
+            // 除空气外的方块都不透明，列顶就是第一个非空气方块
+            int firstSolidZ = chunk->GetColumnHeight(x, y) >= 2 ? chunk->GetColumnHeight(x, y) : -1;
             
             // 只填充地表到海平面之间的水 
-            if (firstSolidZ >= 0 && firstSolidZ < g_theGame->g_seaLevel)
+            if (firstSolidZ >= 0 && firstSolidZ < m_settings.m_seaLevel)
             {
                 // 从地表+1到海平面-1，填充连续的AIR为水
-                for (int z = firstSolidZ + 1; z < g_theGame->g_seaLevel; z++)
+                for (int z = firstSolidZ + 1; z < m_settings.m_seaLevel; z++)
                 {
                     int idx = LocalCoordsToIndex(x, y, z);
                     
                     // 只填充AIR，不填充已有的其他方块
-                    if (chunk->m_blocks[idx].m_typeIndex == BLOCK_TYPE_AIR)
+                    if (chunk->m_buildBlocks[idx].m_typeIndex == BLOCK_TYPE_AIR)
                     {
-                        chunk->m_blocks[idx].SetType(BLOCK_TYPE_WATER);
+                        chunk->m_buildBlocks[idx].SetType(BLOCK_TYPE_WATER);
+                        chunk->UpdateColumnHeight(x, y, z);
                     }
                     else
                     {
@@ -207,12 +516,13 @@ void WorldGenPipeline::ExecuteWaterStage(Chunk* chunk, ChunkGenData* chunkGenDat
             // ===== 3. 如果整个柱子都是空气（深海），填满到海平面 =====
             if (firstSolidZ < 0)
             {
-                for (int z = 2; z < g_theGame->g_seaLevel; z++)
+                for (int z = 2; z < m_settings.m_seaLevel; z++)
                 {
                     int idx = LocalCoordsToIndex(x, y, z);
-                    if (chunk->m_blocks[idx].m_typeIndex == BLOCK_TYPE_AIR)
+                    if (chunk->m_buildBlocks[idx].m_typeIndex == BLOCK_TYPE_AIR)
                     {
-                        chunk->m_blocks[idx].SetType(BLOCK_TYPE_WATER);
+                        chunk->m_buildBlocks[idx].SetType(BLOCK_TYPE_WATER);
+                        chunk->UpdateColumnHeight(x, y, z);
                     }
                 }
             }
@@ -223,6 +533,7 @@ void WorldGenPipeline::ExecuteWaterStage(Chunk* chunk, ChunkGenData* chunkGenDat
 void WorldGenPipeline::ExecuteFeatureStage(Chunk* chunk, ChunkGenData* chunkGenData)
 {
     IntVec2 chunkCoords = chunk->GetThisChunkCoords();
+    bool placedTree = false;
     
     for (int y = 0; y < CHUNK_SIZE_Y; y++)
     {
@@ -236,10 +547,10 @@ void WorldGenPipeline::ExecuteFeatureStage(Chunk* chunk, ChunkGenData* chunkGenD
             if (m_featurePlacer.ShouldPlaceTree(worldX, worldY, biome))
             {
                 int surfaceZ = -1;
-                for (int z = CHUNK_SIZE_Z - 1; z >= 2; --z)
+                for (int z = chunk->GetColumnHeight(x, y); z >= 2; --z)
                 {
                     int idx = LocalCoordsToIndex(x, y, z);
-                    uint8_t t = chunk->m_blocks[idx].m_typeIndex;
+                    uint8_t t = chunk->m_buildBlocks[idx].m_typeIndex;
 
                     if (t == BLOCK_TYPE_GRASS || t == BLOCK_TYPE_DIRT ||
                         t == BLOCK_TYPE_SAND || t == BLOCK_TYPE_SNOW)
@@ -255,7 +566,7 @@ void WorldGenPipeline::ExecuteFeatureStage(Chunk* chunk, ChunkGenData* chunkGenD
                     for (int z = surfaceZ + 1; z <= surfaceZ + 10; ++z)
                     {
                         int id = LocalCoordsToIndex(x, y, z);
-                        if (chunk->m_blocks[id].m_typeIndex != BLOCK_TYPE_AIR)
+                        if (chunk->m_buildBlocks[id].m_typeIndex != BLOCK_TYPE_AIR)
                         {
                             hasSpace = false;
                             break;
@@ -264,11 +575,18 @@ void WorldGenPipeline::ExecuteFeatureStage(Chunk* chunk, ChunkGenData* chunkGenD
                     if (hasSpace)
                     {
                         m_featurePlacer.PlaceTree(chunk, x, y, surfaceZ, biome);
+                        placedTree = true;
                     }
                 }
             }
         }
     }
+    
+    // 树会抬高列顶，放完统一重建。循环里从旧列顶往下找地表和从 CHUNK_SIZE_Z 扫结果一样：树干树叶不算地表，hasSpace 照样读实际方块
+    if (placedTree)
+    {
+        chunk->RebuildHeightMap();
+    }
 }
 
 void WorldGenPipeline::ExecuteCarverStage(Chunk* chunk, ChunkGenData* chunkGenData)
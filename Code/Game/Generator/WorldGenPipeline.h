@@ -1,11 +1,13 @@
 ﻿#pragma once
 #include "BiomeGenerator.h"
 #include "CaveGenerator.h"
+#include "ClimateSampler.h"
 #include "FeaturePlacer.h"
 #include "SurfaceBuilder.h"
 #include "TerrainGenerator.h"
 
 class Chunk;
+class Block;
 
 struct ChunkGenData
 {
@@ -14,6 +16,44 @@ struct ChunkGenData
 	BiomeGenerator::BiomeParameters m_biomeParams[CHUNK_SIZE_X][CHUNK_SIZE_Y];
 };
 
+// 生成开始时从 Game 上的开关拍一份快照；基准/对比工具显式传入，不去改全局设置（worker 上还在生成）
+struct WorldGenOptions
+{
+	bool m_useCoarseDensity = true;    // 密度噪声在 4x4x8 粗格点上采样再三线性插值
+	NoiseSimdLevel m_noiseSimdLevel = NoiseSimdLevel::SCALAR;    // 各阶段成行算噪声用的指令集；结果和标量逐位相同，不进存档
+	bool m_useClimateGrid = true;      // 群系参数在 4 格网格上采样（区域缓存）再双线性插值
+	bool m_useDensityBounds = true;    // 每列按密度上下界跳过离地表很远、结果已经确定的格子
+	bool m_useCoarseCaveNoise = true;  // 洞穴的 cheese/noodle 噪声在 4x4x4 粗格点上采样再插值
+
+	static WorldGenOptions FromGameSettings();
+	// 种子、这组开关和地形参数的哈希；delta 存档用它确认还原出的底图和保存时一致
+	uint32_t ComputeGeneratorHash(WorldGenSettings const& settings) const;
+};
+
+// 改了会改变生成结果的算法就加一：旧生成器存下的 delta 不再套到新地形上
+constexpr uint16_t WORLD_GEN_VERSION = 1;
+
+// 各阶段累计耗时（秒），基准测试用
+struct WorldGenTimings
+{
+	double m_biomeSeconds = 0.0;
+	double m_noiseSeconds = 0.0;
+	double m_caveSeconds = 0.0;
+	double m_finishSeconds = 0.0;    // 高度图 + 水 + 地表替换 + 树
+	int m_numChunks = 0;
+
+	double GetTotalSeconds() const { return m_biomeSeconds + m_noiseSeconds + m_caveSeconds + m_finishSeconds; }
+};
+
+// 粗格点尺寸：chunk 尺寸是格子的整数倍，格点按世界坐标对齐，相邻 chunk 共用边界上的格点平面
+constexpr int DENSITY_CELL_SIZE_XY = 4;
+constexpr int DENSITY_CELL_SIZE_Z = 8;
+constexpr int DENSITY_LATTICE_SIZE_X = CHUNK_SIZE_X / DENSITY_CELL_SIZE_XY + 1;
+constexpr int DENSITY_LATTICE_SIZE_Y = CHUNK_SIZE_Y / DENSITY_CELL_SIZE_XY + 1;
+constexpr int DENSITY_LATTICE_SIZE_Z = CHUNK_SIZE_Z / DENSITY_CELL_SIZE_Z + 1;
+static_assert(CHUNK_SIZE_X % DENSITY_CELL_SIZE_XY == 0 && CHUNK_SIZE_Y % DENSITY_CELL_SIZE_XY == 0, "density cells must tile a chunk");
+static_assert(CHUNK_SIZE_Z % DENSITY_CELL_SIZE_Z == 0, "density cells must tile a chunk");
+
 class WorldGenPipeline
 {
 	enum PipelineStage
@@ -27,22 +67,40 @@ class WorldGenPipeline
 	};
 
 public:
-    WorldGenPipeline();
-    void GenerateChunk(Chunk* chunk);
+    explicit WorldGenPipeline(WorldGenSettings const& settings);
+    WorldGenSettings const& GetSettings() const { return m_settings; }
+    void GenerateChunk(Chunk* chunk, const WorldGenOptions& options, WorldGenTimings* outTimings = nullptr);
+
+    // 只跑群系和密度两步，写进调用方的连续方块数组（粗格点/逐格对比工具用）。
+    // 返回真正算了密度的格子数（其余由上下界直接定成石头或空气）
+    void SampleChunkBiomes(IntVec2 chunkCoords, ChunkGenData* chunkGenData, const WorldGenOptions& options);
+    int FillChunkDensity(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options);
+    // 在已经填好密度的方块上单独跑洞穴阶段（洞穴基准测试用）
+    void CarveChunkCaves(IntVec2 chunkCoords, const ChunkGenData& chunkGenData, Block* blocks, const CaveCarveOptions& options);
     
 private:
-    void ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenData);
-    void ExecuteNoiseStage(Chunk* chunk, ChunkGenData* chunkGenData);
-    void ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenData);
+    void ExecuteBiomeStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options);
+    void ExecuteNoiseStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options);
+    void ComputeChunkDensityBounds(ChunkGenData* chunkGenData, const WorldGenOptions& options,
+        TerrainGenerator::ColumnDensityTerms outTerms[CHUNK_SIZE_X][CHUNK_SIZE_Y],
+        TerrainGenerator::ColumnDensityBounds outBounds[CHUNK_SIZE_X][CHUNK_SIZE_Y]);
+    int FillDensityExact(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options);
+    int FillDensityCoarse(IntVec2 chunkCoords, ChunkGenData* chunkGenData, Block* outBlocks, const WorldGenOptions& options);
+    void ExecuteSurfaceStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options);
     void ExecuteFeatureStage(Chunk* chunk, ChunkGenData* chunkGenData);
     void ExecuteWaterStage(Chunk* chunk, ChunkGenData* chunkGenData);
-    void ExecuteCaveStage(Chunk* chunk, ChunkGenData* chunkGenData);
+    void ExecuteCaveStage(Chunk* chunk, ChunkGenData* chunkGenData, const WorldGenOptions& options);
     void ExecuteCarverStage(Chunk* chunk, ChunkGenData* chunkGenData);
 	float GetZBias(int z);
 
+    WorldGenSettings m_settings;   // 本世界锁定的地形参数，下面的生成器都引用这一份，必须先构造
     BiomeGenerator m_biomeGen;
     TerrainGenerator m_terrainGen;
     CaveGenerator m_caveGen;
     SurfaceBuilder m_surfaceBuilder;
     FeaturePlacer m_featurePlacer;
+    ClimateSampler m_climateSampler;
+
+public:
+    ClimateSampler& GetClimateSampler() { return m_climateSampler; }
 };
@@ -0,0 +1,195 @@
+﻿#include "WorldGenSettings.h"
+
+#include <cstring>
+
+#include "Game/Game.hpp"
+
+extern Game* g_theGame;
+
+namespace
+{
+    constexpr uint32_t MAX_CURVE_POINTS = 64;
+
+    template <typename T>
+    void AppendValue(std::vector<uint8_t>& buffer, T const& value)
+    {
+        uint8_t const* bytes = reinterpret_cast<uint8_t const*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+
+    template <typename T>
+    bool ReadValue(std::vector<uint8_t> const& buffer, size_t& offset, T& outValue)
+    {
+        if (offset + sizeof(T) > buffer.size())
+            return false;
+        memcpy(&outValue, buffer.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return true;
+    }
+
+    bool ReadValue(std::vector<uint8_t> const& buffer, size_t& offset, bool& outValue)
+    {
+        uint8_t byte = 0;
+        if (!ReadValue(buffer, offset, byte) || byte > 1)
+            return false;
+        outValue = byte != 0;
+        return true;
+    }
+
+    template <typename T>
+    void HashValue(uint32_t& hash, T const& value)
+    {
+        uint8_t const* bytes = reinterpret_cast<uint8_t const*>(&value);
+        for (size_t i = 0; i < sizeof(T); ++i)
+        {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    }
+
+    void AppendCurve(std::vector<uint8_t>& buffer, std::vector<Vec2> const& points)
+    {
+        AppendValue(buffer, (uint32_t)points.size());
+        for (Vec2 const& point : points)
+        {
+            AppendValue(buffer, point.x);
+            AppendValue(buffer, point.y);
+        }
+    }
+
+    bool ReadCurve(std::vector<uint8_t> const& buffer, size_t& offset, std::vector<Vec2>& outPoints)
+    {
+        uint32_t numPoints = 0;
+        if (!ReadValue(buffer, offset, numPoints) || numPoints > MAX_CURVE_POINTS)
+            return false;
+        outPoints.resize(numPoints);
+        for (Vec2& point : outPoints)
+        {
+            if (!ReadValue(buffer, offset, point.x) || !ReadValue(buffer, offset, point.y))
+                return false;
+        }
+        return true;
+    }
+
+    void HashCurve(uint32_t& hash, std::vector<Vec2> const& points)
+    {
+        HashValue(hash, (uint32_t)points.size());
+        for (Vec2 const& point : points)
+        {
+            HashValue(hash, point.x);
+            HashValue(hash, point.y);
+        }
+    }
+
+    // 三个操作共用同一份字段顺序，加字段只改这里
+    template <typename Settings, typename Visitor>
+    void VisitScalars(Settings& settings, Visitor&& visit)
+    {
+        visit(settings.m_densityNoiseScale);
+        visit(settings.m_densityNoiseOctaves);
+        visit(settings.m_terrainHeight);
+        visit(settings.m_terrainReferenceHeight);
+        visit(settings.m_biasPerZ);
+        visit(settings.m_continentNoiseScale);
+        visit(settings.m_continentNoiseOctaves);
+        visit(settings.m_erosionNoiseScale);
+        visit(settings.m_erosionNoiseOctaves);
+        visit(settings.m_peaksValleysNoiseOctaves);
+        visit(settings.m_temperatureNoiseScale);
+        visit(settings.m_temperatureNoiseOctaves);
+        visit(settings.m_humidityNoiseScale);
+        visit(settings.m_humidityNoiseOctaves);
+        visit(settings.m_seaEnabled);
+        visit(settings.m_seaLevel);
+        visit(settings.m_densityNoiseEnabled);
+        visit(settings.m_densityNoiseBiasEnabled);
+        visit(settings.m_continentHeightOffsetEnabled);
+        visit(settings.m_continentHeightScaleEnabled);
+        visit(settings.m_blockReplacementEnabled);
+        visit(settings.m_caveCarvingEnabled);
+        visit(settings.m_treeGenerationEnabled);
+    }
+}
+
+WorldGenSettings WorldGenSettings::FromGameSettings()
+{
+    Game const* game = g_theGame;
+    WorldGenSettings settings;
+    settings.m_densityNoiseScale = game->g_densityNoiseScale;
+    settings.m_densityNoiseOctaves = game->g_densityNoiseOctaves;
+    settings.m_terrainHeight = game->g_terrainHeight;
+    settings.m_terrainReferenceHeight = game->g_terrainReferenceHeight;
+    settings.m_biasPerZ = game->g_biasPerZ;
+    settings.m_continentNoiseScale = game->g_continentNoiseScale;
+    settings.m_continentNoiseOctaves = game->g_continentNoiseOctaves;
+    settings.m_heightOffsetCurvePoints = game->g_heightOffsetCurvePoints;
+    settings.m_heightScaleCurvePoints = game->g_heightScaleCurvePoints;
+    settings.m_erosionNoiseScale = game->g_erosionNoiseScale;
+    settings.m_erosionNoiseOctaves = game->g_erosionNoiseOctaves;
+    settings.m_peaksValleysNoiseOctaves = game->g_peaksValleysNoiseOctaves;
+    settings.m_temperatureNoiseScale = game->g_temperatureNoiseScale;
+    settings.m_temperatureNoiseOctaves = game->g_temperatureNoiseOctaves;
+    settings.m_humidityNoiseScale = game->g_humidityNoiseScale;
+    settings.m_humidityNoiseOctaves = game->g_humidityNoiseOctaves;
+    settings.m_seaEnabled = game->g_seaEnabled;
+    settings.m_seaLevel = game->g_seaLevel;
+    settings.m_densityNoiseEnabled = game->g_densityNoiseEnabled;
+    settings.m_densityNoiseBiasEnabled = game->g_densityNoiseBiasEnabled;
+    settings.m_continentHeightOffsetEnabled = game->g_continentHeightOffsetEnabled;
+    settings.m_continentHeightScaleEnabled = game->g_continentHeightScaleEnabled;
+    settings.m_blockReplacementEnabled = game->g_blockReplacementEnabled;
+    settings.m_caveCarvingEnabled = game->g_caveCarvingEnabled;
+    settings.m_treeGenerationEnabled = game->g_treeGenerationEnabled;
+    return settings;
+}
+
+void WorldGenSettings::ApplyToGameSettings() const
+{
+    Game* game = g_theGame;
+    game->g_densityNoiseScale = m_densityNoiseScale;
+    game->g_densityNoiseOctaves = m_densityNoiseOctaves;
+    game->g_terrainHeight = m_terrainHeight;
+    game->g_terrainReferenceHeight = m_terrainReferenceHeight;
+    game->g_biasPerZ = m_biasPerZ;
+    game->g_continentNoiseScale = m_continentNoiseScale;
+    game->g_continentNoiseOctaves = m_continentNoiseOctaves;
+    game->g_heightOffsetCurvePoints = m_heightOffsetCurvePoints;
+    game->g_heightScaleCurvePoints = m_heightScaleCurvePoints;
+    game->g_erosionNoiseScale = m_erosionNoiseScale;
+    game->g_erosionNoiseOctaves = m_erosionNoiseOctaves;
+    game->g_peaksValleysNoiseOctaves = m_peaksValleysNoiseOctaves;
+    game->g_temperatureNoiseScale = m_temperatureNoiseScale;
+    game->g_temperatureNoiseOctaves = m_temperatureNoiseOctaves;
+    game->g_humidityNoiseScale = m_humidityNoiseScale;
+    game->g_humidityNoiseOctaves = m_humidityNoiseOctaves;
+    game->g_seaEnabled = m_seaEnabled;
+    game->g_seaLevel = m_seaLevel;
+    game->g_densityNoiseEnabled = m_densityNoiseEnabled;
+    game->g_densityNoiseBiasEnabled = m_densityNoiseBiasEnabled;
+    game->g_continentHeightOffsetEnabled = m_continentHeightOffsetEnabled;
+    game->g_continentHeightScaleEnabled = m_continentHeightScaleEnabled;
+    game->g_blockReplacementEnabled = m_blockReplacementEnabled;
+    game->g_caveCarvingEnabled = m_caveCarvingEnabled;
+    game->g_treeGenerationEnabled = m_treeGenerationEnabled;
+}
+
+void WorldGenSettings::AppendTo(std::vector<uint8_t>& buffer) const
+{
+    VisitScalars(*this, [&buffer](auto const& value) { AppendValue(buffer, value); });
+    AppendCurve(buffer, m_heightOffsetCurvePoints);
+    AppendCurve(buffer, m_heightScaleCurvePoints);
+}
+
+bool WorldGenSettings::ReadFrom(std::vector<uint8_t> const& buffer, size_t& offset)
+{
+    bool isValid = true;
+    VisitScalars(*this, [&](auto& value) { isValid = isValid && ReadValue(buffer, offset, value); });
+    return isValid && ReadCurve(buffer, offset, m_heightOffsetCurvePoints) && ReadCurve(buffer, offset, m_heightScaleCurvePoints);
+}
+
+uint32_t WorldGenSettings::AccumulateHash(uint32_t hash) const
+{
+    VisitScalars(*this, [&hash](auto const& value) { HashValue(hash, value); });
+    HashCurve(hash, m_heightOffsetCurvePoints);
+    HashCurve(hash, m_heightScaleCurvePoints);
+    return hash;
+}
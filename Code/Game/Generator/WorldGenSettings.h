@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Engine/Math/Vec2.hpp"
+
+// 会改变生成结果的地形参数。建世界时从 Game 上（ImGui 调的那一份）拍快照，和开关一起存进 WorldGen.dat；
+// 生成器只读所在 WorldGenPipeline 的这一份，拖滑条要 Regenerate 才生效，已有世界的 delta 始终套在同一份底图上
+struct WorldGenSettings
+{
+	float m_densityNoiseScale = 128.0f;
+	int m_densityNoiseOctaves = 8;
+	float m_terrainHeight = 64.0f;
+	float m_terrainReferenceHeight = 80.0f;
+	float m_biasPerZ = 0.016f;
+	float m_continentNoiseScale = 1024.0f;
+	int m_continentNoiseOctaves = 4;
+	std::vector<Vec2> m_heightOffsetCurvePoints;
+	std::vector<Vec2> m_heightScaleCurvePoints;
+	float m_erosionNoiseScale = 512.0f;
+	int m_erosionNoiseOctaves = 8;
+	int m_peaksValleysNoiseOctaves = 8;   // 峰谷噪声沿用湿度的尺度，没有单独的 scale
+	float m_temperatureNoiseScale = 512.0f;
+	int m_temperatureNoiseOctaves = 2;
+	float m_humidityNoiseScale = 512.0f;
+	int m_humidityNoiseOctaves = 4;
+	bool m_seaEnabled = true;
+	int m_seaLevel = 64;
+	bool m_densityNoiseEnabled = true;
+	bool m_densityNoiseBiasEnabled = true;
+	bool m_continentHeightOffsetEnabled = true;
+	bool m_continentHeightScaleEnabled = true;
+	bool m_blockReplacementEnabled = true;
+	bool m_caveCarvingEnabled = true;
+	bool m_treeGenerationEnabled = true;
+
+	static WorldGenSettings FromGameSettings();
+	void ApplyToGameSettings() const;     // 载入已有世界后让 ImGui 显示这个世界实际用的参数
+
+	// WorldGen.dat 里的编码；ReadFrom 越界或曲线点数不合理时返回 false
+	void AppendTo(std::vector<uint8_t>& buffer) const;
+	bool ReadFrom(std::vector<uint8_t> const& buffer, size_t& offset);
+
+	// 在 hash 上接着做 FNV-1a，覆盖上面每一项
+	uint32_t AccumulateHash(uint32_t hash) const;
+};
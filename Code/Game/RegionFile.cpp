@@ -0,0 +1,435 @@
+﻿#include "RegionFile.h"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "Engine/Core/EngineCommon.hpp"
+#include "Engine/Core/ErrorWarningAssert.hpp"
+
+RegionFile::RegionFile(std::string const& path)
+    : m_path(path)
+{
+    memset(m_entries, 0, sizeof(m_entries));
+}
+
+RegionFile::~RegionFile()
+{
+    Close();
+}
+
+bool RegionFile::Open()
+{
+    // 文件不存在不算错误：表为空，第一次写入时再创建
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+    {
+        m_existsOnDisk = false;
+        return true;
+    }
+    m_existsOnDisk = true;
+    return ReadHeader();
+}
+
+void RegionFile::Close()
+{
+    if (m_file.is_open())
+    {
+        m_file.flush();
+        m_file.close();
+    }
+}
+
+bool RegionFile::ReadChunk(int localIndex, std::vector<uint8_t>& out)
+{
+    RegionChunkEntry const& entry = m_entries[localIndex];
+    if (entry.byteLength == 0 || !m_file.is_open())
+        return false;
+
+    out.resize(entry.byteLength);
+    m_file.clear();
+    m_file.seekg((std::streamoff)entry.sectorOffset * REGION_SECTOR_BYTES);
+    m_file.read(reinterpret_cast<char*>(out.data()), entry.byteLength);
+    if (!m_file || m_file.gcount() != (std::streamsize)entry.byteLength)
+    {
+        DebuggerPrintf("Region %s: short read for chunk slot %d\n", m_path.c_str(), localIndex);
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+bool RegionFile::WriteChunk(int localIndex, uint8_t const* data, size_t size)
+{
+    if (size == 0 || size > 0xFFFFFFFFu)
+        return false;
+    if (!m_existsOnDisk && !CreateOnDisk())
+        return false;
+
+    RegionChunkEntry const oldEntry = m_entries[localIndex];
+    int neededSectors = GetSectorCount((uint32_t)size);
+    int oldSectors = oldEntry.byteLength ? GetSectorCount(oldEntry.byteLength) : 0;
+
+    // 永远写到新分配的扇区：旧扇区在分配时仍标记为占用，不会被 first-fit 挑中，
+    // 表项改完之后才归还。中途崩溃时表里仍是完整的旧数据
+    uint32_t sectorOffset = AllocateSectors(neededSectors);
+
+    static const char s_zeroSector[REGION_SECTOR_BYTES] = {};
+    size_t padding = (size_t)neededSectors * REGION_SECTOR_BYTES - size;
+
+    m_file.clear();
+    m_file.seekp((std::streamoff)sectorOffset * REGION_SECTOR_BYTES);
+    m_file.write(reinterpret_cast<char const*>(data), (std::streamsize)size);
+    if (padding > 0)
+        m_file.write(s_zeroSector, (std::streamsize)padding);
+
+    m_file.flush();
+    if (!m_file)
+    {
+        DebuggerPrintf("Region %s: payload write failed for chunk slot %d\n", m_path.c_str(), localIndex);
+        SetSectorsUsed(sectorOffset, neededSectors, false);
+        return false;
+    }
+
+    // 负载写完再改表项
+    RegionChunkEntry entry;
+    entry.sectorOffset = sectorOffset;
+    entry.byteLength = (uint32_t)size;
+    m_file.seekp((std::streamoff)(sizeof(RegionFileHeader) + sizeof(RegionChunkEntry) * localIndex));
+    m_file.write(reinterpret_cast<char const*>(&entry), sizeof(RegionChunkEntry));
+    m_file.flush();
+
+    if (!m_file)
+    {
+        // 表项可能只写了一半：内存里仍指向旧数据，新扇区不归还，下次打开时按磁盘上的表重建占用
+        DebuggerPrintf("Region %s: table write failed for chunk slot %d\n", m_path.c_str(), localIndex);
+        return false;
+    }
+    m_entries[localIndex] = entry;
+
+    // 表项已经指向新负载，旧扇区才可以给别的 chunk 用
+    if (oldSectors > 0)
+        SetSectorsUsed(oldEntry.sectorOffset, oldSectors, false);
+    return true;
+}
+
+int RegionFile::GetNumSavedChunks() const
+{
+    int count = 0;
+    for (RegionChunkEntry const& entry : m_entries)
+    {
+        if (entry.byteLength != 0)
+            count++;
+    }
+    return count;
+}
+
+int RegionFile::GetLocalIndex(IntVec2 const& chunkCoords)
+{
+    return (chunkCoords.x & REGION_MASK) | ((chunkCoords.y & REGION_MASK) << REGION_BITS);
+}
+
+int RegionFile::GetSectorCount(uint32_t byteLength)
+{
+    return (int)((byteLength + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES);
+}
+
+bool RegionFile::CreateOnDisk()
+{
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(m_path).parent_path(), ec);
+
+    {
+        std::ofstream out(m_path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            ERROR_RECOVERABLE("Failed to create region file " + m_path);
+            return false;
+        }
+        std::vector<char> headerBytes((size_t)HEADER_SECTORS * REGION_SECTOR_BYTES, 0);
+        RegionFileHeader header;
+        memcpy(headerBytes.data(), &header, sizeof(RegionFileHeader));
+        out.write(headerBytes.data(), (std::streamsize)headerBytes.size());
+    }
+
+    m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!m_file.is_open())
+        return false;
+
+    memset(m_entries, 0, sizeof(m_entries));
+    m_usedSectors.assign(HEADER_SECTORS, true);
+    m_existsOnDisk = true;
+    return true;
+}
+
+bool RegionFile::ReadHeader()
+{
+    m_file.seekg(0, std::ios::end);
+    std::streamoff fileSize = m_file.tellg();
+    if (fileSize < HEADER_BYTES)
+    {
+        ERROR_RECOVERABLE("Region file too small for header: " + m_path);
+        return false;
+    }
+
+    RegionFileHeader header;
+    m_file.seekg(0);
+    m_file.read(reinterpret_cast<char*>(&header), sizeof(RegionFileHeader));
+    if (!m_file || !header.Validate())
+    {
+        ERROR_RECOVERABLE("Invalid region header: " + m_path);
+        return false;
+    }
+    m_file.read(reinterpret_cast<char*>(m_entries), sizeof(m_entries));
+    if (!m_file)
+        return false;
+
+    int numSectors = (int)((fileSize + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES);
+    m_usedSectors.assign(numSectors, false);
+    for (int i = 0; i < HEADER_SECTORS; ++i)
+    {
+        m_usedSectors[i] = true;
+    }
+
+    for (int i = 0; i < REGION_CHUNK_COUNT; ++i)
+    {
+        RegionChunkEntry& entry = m_entries[i];
+        if (entry.byteLength == 0)
+            continue;
+
+        int count = GetSectorCount(entry.byteLength);
+        if (entry.sectorOffset < (uint32_t)HEADER_SECTORS || entry.sectorOffset + count > (uint32_t)numSectors)
+        {
+            // 表项越界（写到一半崩溃等），当作不存在，重新生成
+            DebuggerPrintf("Region %s: dropping corrupt entry %d\n", m_path.c_str(), i);
+            entry.sectorOffset = 0;
+            entry.byteLength = 0;
+            continue;
+        }
+        SetSectorsUsed(entry.sectorOffset, count, true);
+    }
+    return true;
+}
+
+uint32_t RegionFile::AllocateSectors(int count)
+{
+    // first-fit 找一段连续空闲扇区，找不到就追加到文件末尾
+    int runStart = 0;
+    int runLength = 0;
+    for (int i = HEADER_SECTORS; i < (int)m_usedSectors.size(); ++i)
+    {
+        if (m_usedSectors[i])
+        {
+            runLength = 0;
+            continue;
+        }
+        if (runLength == 0)
+            runStart = i;
+        if (++runLength == count)
+        {
+            SetSectorsUsed((uint32_t)runStart, count, true);
+            return (uint32_t)runStart;
+        }
+    }
+
+    uint32_t first = (uint32_t)m_usedSectors.size();
+    m_usedSectors.resize(m_usedSectors.size() + count, false);
+    SetSectorsUsed(first, count, true);
+    return first;
+}
+
+void RegionFile::SetSectorsUsed(uint32_t first, int count, bool used)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (first + i < m_usedSectors.size())
+            m_usedSectors[first + i] = used;
+    }
+}
+
+RegionStorage::RegionStorage(std::string const& saveFolder)
+    : m_saveFolder(saveFolder)
+    , m_folder(saveFolder + "/Regions")
+{
+}
+
+RegionStorage::~RegionStorage()
+{
+    CloseAll();
+}
+
+bool RegionStorage::HasChunk(IntVec2 const& chunkCoords)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RegionFile* region = GetOrOpenRegion(GetRegionCoords(chunkCoords));
+    return region && region->HasChunk(RegionFile::GetLocalIndex(chunkCoords));
+}
+
+bool RegionStorage::ReadChunk(IntVec2 const& chunkCoords, std::vector<uint8_t>& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RegionFile* region = GetOrOpenRegion(GetRegionCoords(chunkCoords));
+    return region && region->ReadChunk(RegionFile::GetLocalIndex(chunkCoords), out);
+}
+
+bool RegionStorage::WriteChunk(IntVec2 const& chunkCoords, std::vector<uint8_t> const& data)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    RegionFile* region = GetOrOpenRegion(GetRegionCoords(chunkCoords));
+    return region && region->WriteChunk(RegionFile::GetLocalIndex(chunkCoords), data.data(), data.size());
+}
+
+void RegionStorage::CloseAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [coords, region] : m_regions)
+    {
+        delete region;
+    }
+    m_regions.clear();
+}
+
+void RegionStorage::Shutdown()
+{
+    // CloseAll 之后下一次读写会重新打开文件；关闭之后不会，迟到的存盘任务写不进别的世界的存档
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [coords, region] : m_regions)
+    {
+        delete region;
+    }
+    m_regions.clear();
+    m_isShutdown = true;
+}
+
+bool RegionStorage::IsShutdown()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_isShutdown;
+}
+
+int RegionStorage::CollectSavedChunks(std::vector<IntVec2>& outChunkCoords)
+{
+    // 只读每个 region 的表头，世界加载时调用一次
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::error_code ec;
+    if (m_isShutdown || !std::filesystem::is_directory(m_folder, ec))
+        return 0;
+
+    int numFound = 0;
+    for (auto const& entry : std::filesystem::directory_iterator(m_folder, ec))
+    {
+        std::string filename = entry.path().filename().string();
+        IntVec2 regionCoords;
+        if (std::sscanf(filename.c_str(), "Region(%d,%d).region", &regionCoords.x, &regionCoords.y) != 2)
+            continue;
+        if (filename != MakeRegionFilename(regionCoords))
+            continue;
+
+        RegionFile region(entry.path().string());
+        if (!region.Open())
+            continue;
+        for (int localIndex = 0; localIndex < REGION_CHUNK_COUNT; ++localIndex)
+        {
+            if (!region.HasChunk(localIndex))
+                continue;
+            int localX = localIndex & REGION_MASK;
+            int localY = localIndex >> REGION_BITS;
+            outChunkCoords.push_back(IntVec2((regionCoords.x << REGION_BITS) | localX, (regionCoords.y << REGION_BITS) | localY));
+            numFound++;
+        }
+    }
+    return numFound;
+}
+
+bool RegionStorage::SetAsideChunk(IntVec2 const& chunkCoords, std::vector<uint8_t> const& data)
+{
+    // 读了却不能用的存档（生成器对不上的 delta）原样搬到 Regions/SetAside/ 下，region 里的那份之后可以被覆盖；
+    // 放在 region 目录里，只有 Regenerate 删 region 文件时才一起删掉。已有的文件从不覆盖：内容相同就算已经搬过，
+    // 不同就换下一个编号
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_isShutdown)
+        return false;
+    std::string folder = m_folder + "/SetAside";
+    std::error_code ec;
+    std::filesystem::create_directories(folder, ec);
+
+    std::string path;
+    for (int copyIndex = 0; ; ++copyIndex)
+    {
+        if (copyIndex >= 100)
+            return false;
+        char name[64];
+        std::snprintf(name, sizeof(name), "Chunk(%d,%d)_%d.delta", chunkCoords.x, chunkCoords.y, copyIndex);
+        path = folder + "/" + name;
+        if (!std::filesystem::exists(path, ec))
+            break;
+
+        std::vector<uint8_t> existing;
+        FILE* existingFile = std::fopen(path.c_str(), "rb");
+        if (existingFile)
+        {
+            uint8_t readBuffer[4096];
+            size_t numRead;
+            while ((numRead = std::fread(readBuffer, 1, sizeof(readBuffer), existingFile)) > 0)
+                existing.insert(existing.end(), readBuffer, readBuffer + numRead);
+            std::fclose(existingFile);
+        }
+        if (existing == data)
+            return true;
+    }
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool success = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    success = std::fclose(file) == 0 && success;
+    if (!success)
+        std::filesystem::remove(path, ec);
+    return success;
+}
+
+IntVec2 RegionStorage::GetRegionCoords(IntVec2 const& chunkCoords)
+{
+    return IntVec2(chunkCoords.x >> REGION_BITS, chunkCoords.y >> REGION_BITS);
+}
+
+std::string RegionStorage::MakeRegionFilename(IntVec2 const& regionCoords)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "Region(%d,%d).region", regionCoords.x, regionCoords.y);
+    return std::string(name);
+}
+
+void RegionStorage::DeleteAllRegionFiles(std::string const& folder)
+{
+    std::error_code ec;
+    std::filesystem::remove_all(folder, ec);
+}
+
+RegionFile* RegionStorage::GetOrOpenRegion(IntVec2 const& regionCoords)
+{
+    if (m_isShutdown)
+        return nullptr;
+    auto it = m_regions.find(regionCoords);
+    if (it != m_regions.end())
+        return it->second;
+
+    if ((int)m_regions.size() >= MAX_OPEN_REGION_FILES)
+    {
+        // 句柄太多：全部关掉，活跃的几个马上会被重新打开
+        for (auto& [coords, region] : m_regions)
+        {
+            delete region;
+        }
+        m_regions.clear();
+    }
+
+    RegionFile* region = new RegionFile(m_folder + "/" + MakeRegionFilename(regionCoords));
+    if (!region->Open())
+    {
+        delete region;
+        return nullptr;
+    }
+    m_regions[regionCoords] = region;
+    return region;
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Engine/Math/IntVec2.hpp"
+
+constexpr int REGION_BITS = 5;
+constexpr int REGION_SIZE = 1 << REGION_BITS;                 // 32 x 32 chunks / region
+constexpr int REGION_MASK = REGION_SIZE - 1;
+constexpr int REGION_CHUNK_COUNT = REGION_SIZE * REGION_SIZE;
+constexpr int REGION_SECTOR_BYTES = 4096;
+constexpr int MAX_OPEN_REGION_FILES = 16;
+constexpr char const* CHUNK_SAVE_FOLDER = "Saves";            // SaveSystem 默认存档目录，旧版单文件 chunk 也在这里
+constexpr char const* REGION_SAVE_FOLDER = "Saves/Regions";
+
+#pragma pack(push, 1)
+struct RegionFileHeader
+{
+    char fourCC[4];      // 'GREG'
+    uint8_t version;     // 1
+    uint8_t regionBits;  // REGION_BITS
+    uint16_t reserved;
+
+    RegionFileHeader()
+        : version(1), regionBits(REGION_BITS), reserved(0)
+    {
+        fourCC[0] = 'G';
+        fourCC[1] = 'R';
+        fourCC[2] = 'E';
+        fourCC[3] = 'G';
+    }
+
+    bool Validate() const
+    {
+        return fourCC[0] == 'G' && fourCC[1] == 'R' &&
+               fourCC[2] == 'E' && fourCC[3] == 'G' &&
+               version == 1 && regionBits == REGION_BITS;
+    }
+};
+
+struct RegionChunkEntry
+{
+    uint32_t sectorOffset;  // 从文件开头算起的扇区号，0 = 不存在
+    uint32_t byteLength;    // 负载实际字节数，占用 ceil(byteLength / 4096) 个扇区
+};
+#pragma pack(pop)
+
+// 一个 region 文件：固定大小的 offset/length 表 + 按扇区对齐的 chunk 负载
+class RegionFile
+{
+public:
+    static constexpr int HEADER_BYTES = (int)(sizeof(RegionFileHeader) + sizeof(RegionChunkEntry) * REGION_CHUNK_COUNT);
+    static constexpr int HEADER_SECTORS = (HEADER_BYTES + REGION_SECTOR_BYTES - 1) / REGION_SECTOR_BYTES;
+
+public:
+    explicit RegionFile(std::string const& path);
+    ~RegionFile();
+
+    bool Open();
+    void Close();
+
+    bool HasChunk(int localIndex) const { return m_entries[localIndex].byteLength != 0; }
+    bool ReadChunk(int localIndex, std::vector<uint8_t>& out);
+    bool WriteChunk(int localIndex, uint8_t const* data, size_t size);
+
+    int GetNumSavedChunks() const;
+    static int GetLocalIndex(IntVec2 const& chunkCoords);
+    static int GetSectorCount(uint32_t byteLength);
+
+private:
+    bool CreateOnDisk();
+    bool ReadHeader();
+    uint32_t AllocateSectors(int count);
+    void SetSectorsUsed(uint32_t first, int count, bool used);
+
+private:
+    std::string m_path;
+    std::fstream m_file;
+    bool m_existsOnDisk = false;
+    RegionChunkEntry m_entries[REGION_CHUNK_COUNT];
+    std::vector<bool> m_usedSectors;
+};
+
+// 按 region 坐标缓存打开的 RegionFile；IO 线程和主线程都会访问，所有操作串行化
+class RegionStorage
+{
+public:
+    explicit RegionStorage(std::string const& saveFolder = CHUNK_SAVE_FOLDER);
+    ~RegionStorage();
+
+    bool HasChunk(IntVec2 const& chunkCoords);
+    bool ReadChunk(IntVec2 const& chunkCoords, std::vector<uint8_t>& out);
+    bool WriteChunk(IntVec2 const& chunkCoords, std::vector<uint8_t> const& data);
+    void CloseAll();
+    void Shutdown();            // 关掉所有文件，之后的读写一律失败（换世界、删存档之前调用）
+    bool IsShutdown();
+    int CollectSavedChunks(std::vector<IntVec2>& outChunkCoords);
+    std::string const& GetSaveFolder() const { return m_saveFolder; }
+    bool SetAsideChunk(IntVec2 const& chunkCoords, std::vector<uint8_t> const& data);
+
+    static IntVec2 GetRegionCoords(IntVec2 const& chunkCoords);
+    static std::string MakeRegionFilename(IntVec2 const& regionCoords);
+    static void DeleteAllRegionFiles(std::string const& folder = REGION_SAVE_FOLDER);
+
+private:
+    RegionFile* GetOrOpenRegion(IntVec2 const& regionCoords);
+
+private:
+    std::string m_saveFolder;   // 存档根目录（旧版单文件 chunk）
+    std::string m_folder;       // m_saveFolder/Regions
+    std::map<IntVec2, RegionFile*> m_regions;
+    std::mutex m_mutex;
+    bool m_isShutdown = false;
+};
@@ -1,11 +1,16 @@
 ﻿#pragma once
+#include <deque>
 #include <map>
 #include <mutex>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "BlockIterator.h"
+#include "ChunkIndex.h"
+#include "ChunkPool.h"
+#include "RegionFile.h"
 #include "Gamecommon.hpp"
 #include "Generator/WorldGenPipeline.h"
 
@@ -14,6 +19,9 @@ struct IntVec2;
 struct Vec3;
 class Block;
 class Chunk;
+class MeshChunkJob;
+class LightChunkJob;
+class SaveChunkJob;
 
 struct GameRaycastResult3D : public RaycastResult3D
 {
@@ -32,6 +40,34 @@ struct BlockHighlight
     Direction m_hitFace;
 };
 
+// 光照调度统计，用来调每帧预算
+struct LightingStats
+{
+    double m_lastFrameMicroseconds = 0.0;
+    int m_lastFrameBlocks = 0;
+    int m_queueDepth = 0;              // 本帧处理完后仍在排队的方块数
+    int m_peakQueueDepth = 0;
+    int m_numDirtyChunks = 0;
+    int m_numLightJobsInFlight = 0;
+    int64_t m_workerBlocks = 0;        // worker 上累计处理的方块数
+    double m_lastSettleSeconds = 0.0;  // 积压从出现到清空
+    double m_maxSettleSeconds = 0.0;
+    double m_lastEditSettleSeconds = 0.0;  // 挖/放引起的光照从标记到清空
+    double m_maxEditSettleSeconds = 0.0;
+    int m_numTrustedLightLoads = 0;         // 存档光照可信、跳过内部重算的加载
+    int64_t m_numBorderFacesSkipped = 0;    // 激活时邻居面没变、不用对齐的边界面
+    int64_t m_numBorderFacesRelit = 0;
+};
+
+struct MeshingStats
+{
+    int64_t m_numMeshBuilds = 0;            // 提交的网格构建（含局部重建）
+    int64_t m_numFirstBuilds = 0;           // 其中第一次建网格的 chunk 数
+    int64_t m_numEditBuilds = 0;            // 挖/放触发的优先重建
+    int64_t m_numBorderSectionsRemeshed = 0;  // 邻居回来时边界变了、要重建的 section
+    int64_t m_numBorderSectionsKept = 0;      // 邻居回来时边界没变、保留原网格的 section
+};
+
 class World
 {
     friend class Game;
@@ -48,13 +84,27 @@ public:
     Chunk* GetChunkFromPlayerCameraPosition(Vec3 cameraPos);
     Chunk* GetChunk(int chunkX, int chunkY);
     Block GetBlockAtWorldCoords(int worldX, int worldY, int worldZ);
+    int GetSurfaceHeightAtWorldXY(int worldX, int worldY);   // 最高不透明方块的 z；chunk 未加载或整列透明返回 -1
 
     void ActivateProcessedChunk(Chunk* chunk);
     
     static IntVec2 WorldToChunkXY(const Vec3& worldPos);
 
     void ProcessDirtyLighting();                         
-    void ProcessNextDirtyLightBlock();                    
+    int DrainLightQueues();
+    int RelightAfterEdit(std::vector<BlockIterator> const& editedBlocks);
+    void VerifyLighting();
+    void BenchmarkLightRemoval();
+    void SortLightDirtyChunksByPriority();
+    void SubmitLightJobs();
+    void ApplyCompletedLightJob(LightChunkJob* job);
+    int ProcessChunkLightQueue(Chunk* chunk, int maxBlocks);
+    void OnChunkLightSettled(Chunk* chunk);
+    void PrioritizeLighting(Chunk* chunk);
+    LightingStats const& GetLightingStats() const { return m_lightingStats; }
+    MeshingStats const& GetMeshingStats() const { return m_meshingStats; }
+    void ReportLightingStats();
+    void ProcessDirtyLightBlock(const BlockIterator& iter);
     void MarkLightingDirty(const BlockIterator& iter);   
     void MarkLightingDirtyIfNotOpaque(const BlockIterator& iter);
     void UndirtyAllBlocksInChunk(Chunk* chunk);
@@ -74,6 +124,26 @@ public:
     void ToggleDebugPrintingMode();
     bool IsDebugging() const;
     bool IsDebuggingPrinting() const;
+
+    void BenchmarkChunkLookup(int numPasses = 200);
+
+    bool HasSavedChunk(IntVec2 const& chunkCoords);
+    void MarkChunkSaved(IntVec2 const& chunkCoords);
+    int ConvertLegacyChunkFiles(std::string const& legacyFolder, bool deleteLegacyFiles);
+    void BenchmarkChunkFormats();
+    void BenchmarkMeshing();
+    void BenchmarkSectionRemesh();
+    void BenchmarkGeneration(int numChunks = 64);
+    void CompareDensityModes(int radius = 2, std::string const& imagePath = "DensityDiff.ppm");
+    void VerifyBatchedNoise();
+    void VerifyDensityBounds(int radius = 2);
+    void BenchmarkCaves(int numChunks = 64);
+    void MarkAllChunkMeshesDirty();
+    void ReportChunkMemory();
+    ChunkPool const& GetChunkPool() const { return m_chunkPool; }
+
+    void EnsureQuadIndexCapacity(unsigned int numQuads);
+    IndexBuffer* GetQuadIndexBuffer() const { return m_quadIndexBuffer; }
     
 private:
     void UpdateTypeToPlace();
@@ -88,13 +158,23 @@ private:
     void DeactivateChunk(IntVec2 chunkCoords);
 
     void ConnectChunkNeighbors(Chunk* chunk);
+    void EnqueueMeshReadyChunk(Chunk* chunk);
+    void RemoveFromMeshReadyQueue(Chunk* chunk);
+    int SubmitReadyChunkMeshes(int maxJobs);
     void DisconnectChunkNeighbors(Chunk* chunk);
     void ForceDeactivateAllChunks();  
     void SaveAllModifiedChunks();
+    void FinishPendingIO(bool discardPendingSaves);
+    void OnSaveJobComplete(SaveChunkJob* job);
+    void ReactivateUnsavedChunk(IntVec2 chunkCoords);
+    void BuildSavedChunkIndex();
+    WorldGenSettings LoadOrCreateGenOptions();
     
     void ProcessCompletedJobs();
     void SubmitNewActivateJobs();
-    void RebuildDirtyMeshes(int maxPerFrame = 2);
+    void RebuildDirtyMeshes(int maxPerFrame = MAX_MESH_JOBS_PER_FRAME);
+    bool SubmitMeshJob(Chunk* chunk);
+    void ApplyCompletedMeshJob(MeshChunkJob* job);
 
     void ComputeCorrectLightInfluence(const BlockIterator& iter, 
                                       uint8_t& outOutdoorLight, 
@@ -109,7 +189,11 @@ private:
 
 public:
     Game* m_owner;
+    uint32_t m_generationId = 0;    // 每个 World 实例唯一；任务带着它，旧世界的任务不会因为地址被复用而误认
     WorldGenPipeline* m_worldGenPipeline;
+    WorldGenOptions m_genOptions;   // 本世界锁定的生成开关：建世界时从 Game 拍一份，和地形参数一起存进 WorldGen.dat
+    uint32_t m_generatorHash = 0;   // m_genOptions + 管线里的地形参数，写进每个 delta 存档
+    RegionStorage* m_regionStorage = nullptr;
     bool m_hasDirtyChunk = false;
 
     BlockHighlight m_highlightedBlock;
@@ -117,8 +201,20 @@ public:
     Shader* m_worldShader = nullptr;
     ConstantBuffer* m_worldConstantBuffer = nullptr;
 
+    // 所有 chunk 共用的 quad 索引 (0,1,2, 0,2,3) + 4n，按需增长
+    IndexBuffer* m_quadIndexBuffer = nullptr;
+    unsigned int m_quadIndexCapacity = 0;
+
     BlockType m_typeToPlace = BLOCK_TYPE_GLOWSTONE;
-    std::deque<BlockIterator> m_dirtyLightBlocks;
+    std::deque<Chunk*> m_lightDirtyChunks;   // 光照队列非空的 chunk，轮转处理
+    std::deque<Chunk*> m_meshReadyChunks;    // 四个邻居刚凑齐、等第一次建网格的 chunk
+    MeshingStats m_meshingStats;
+    int m_numUrgentLightChunks = 0;
+    int m_numLightJobsInFlight = 0;
+    uint32_t m_nextLightJobSerial = 0;
+    double m_lightBacklogStartTime = -1.0;
+    double m_editLightStartTime = -1.0;
+    LightingStats m_lightingStats;
 
     Rgba8 m_skyColor;
     Rgba8 m_outdoorLightColor;
@@ -133,6 +229,8 @@ public:
 
 protected:
     std::map<IntVec2, Chunk*> m_activeChunks;
+    ChunkIndex m_chunkIndex;  // 与 m_activeChunks 同步，负责 O(1) 查找和渲染遍历
+    ChunkPool m_chunkPool;    // 停用/存完的 chunk 回收到这里，激活时优先复用
     std::vector<Chunk*> m_visibleChunks;
     
     std::set<IntVec2> m_queuedChunks;
@@ -141,7 +239,24 @@ protected:
     std::map<IntVec2, Chunk*> m_processingChunks; 
     std::mutex m_processingChunksMutex;
 
+    // 停用后等着存盘的 chunk（只在主线程访问）。存完之前不从磁盘重新加载这个坐标，否则读到的是旧数据；
+    // 写失败时重试几次，仍失败就把 chunk 留在内存里，玩家回到附近时直接重新激活，退出时再试一次
+    struct PendingSave
+    {
+        Chunk* m_chunk = nullptr;
+        int m_numFailures = 0;
+        bool m_isJobInFlight = false;
+    };
+    std::map<IntVec2, PendingSave> m_pendingSaves;
+
+    // 已存档 chunk 坐标，世界构造时从 region 表头和旧版文件名建好，之后由 Chunk::Save 维护
+    std::unordered_set<uint64_t> m_savedChunks;
+    std::mutex m_savedChunksMutex;
+
     int m_generatingChunksCount = 0; //debugging
+
+    int m_numMeshJobsInFlight = 0;
+    uint32_t m_nextMeshJobSerial = 0;
     
     std::vector<Chunk*> m_chunks;
 
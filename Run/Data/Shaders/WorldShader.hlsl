@@ -24,11 +24,18 @@ cbuffer WorldConstants : register(b5)
     float FogFarDistance;
     float FogMaxAlpha;
     float Padding3;
+
+    float2 AtlasGridSize;
+    float2 Padding4;
 };
 
 Texture2D diffuseTexture : register(t0);
 SamplerState diffuseSampler : register(s0);
 
+// Packed chunk vertex (Vertex_PCU layout):
+//   POSITION  chunk-local position, chunk origin comes from ModelToWorldTransform
+//   COLOR     r = outdoor light, g = indoor light, b = face direction id, a = atlas tile id
+//   TEXCOORD  uv in block units (> 1 on greedy-merged quads), wrapped inside the atlas tile
 struct vs_input_t
 {
     float3 localPosition : POSITION;
@@ -36,12 +43,16 @@ struct vs_input_t
     float2 uv : TEXCOORD;
 };
 
+// shade per face direction, same order as Direction: east, west, north, south, up, down
+static const float FaceDirectionShade[6] = { 0.9f, 0.8f, 0.85f, 0.75f, 1.0f, 0.7f };
+
 struct v2p_t
 {
     float4 position : SV_POSITION;
     float4 color : COLOR;
     float2 uv : TEXCOORD0;
     float3 worldPosition : TEXCOORD1;
+    float4 atlasTile : TEXCOORD2;
 };
 
 v2p_t VertexMain(vs_input_t input)
@@ -57,8 +68,14 @@ v2p_t VertexMain(vs_input_t input)
     
     output.position = clipPos;
     output.worldPosition = worldPos.xyz;
-    output.color = input.color;
+    uint faceId = min((uint)round(input.color.b * 255.0f), 5);
+    uint tileId = (uint)round(input.color.a * 255.0f);
+    uint atlasColumns = (uint)AtlasGridSize.x;
+    float2 tileSize = 1.0f / AtlasGridSize;
+
+    output.color = float4(input.color.r, input.color.g, FaceDirectionShade[faceId], 1.0f);
     output.uv = input.uv;
+    output.atlasTile = float4(float2(tileId % atlasColumns, tileId / atlasColumns) * tileSize, tileSize);
     
     return output;
 }
@@ -71,7 +88,12 @@ float3 DiminishingAdd(float3 a, float3 b)
 
 float4 PixelMain(v2p_t input) : SV_TARGET
 {
-    float4 texColor = diffuseTexture.Sample(diffuseSampler, input.uv);
+    // uv repeats once per block; wrap it inside the atlas tile and keep the
+    // unwrapped gradients so mip selection does not jump at block edges
+    float2 tileUV = input.atlasTile.xy + frac(input.uv) * input.atlasTile.zw;
+    float2 gradX = ddx(input.uv) * input.atlasTile.zw;
+    float2 gradY = ddy(input.uv) * input.atlasTile.zw;
+    float4 texColor = diffuseTexture.SampleGrad(diffuseSampler, tileUV, gradX, gradY);
     
     if (texColor.a < 0.1f)
         discard;